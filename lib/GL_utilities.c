@@ -12,6 +12,8 @@
 // 131014: Added tesselation shader support
 // 150812: Added a NULL check on file names in readFile, makes Visual Studio happier.
 // 160302: Uses fopen_s on Windows, as suggested by Jesper Post. Should reduce warnings a bit.
+// 261018: Linked programs are cached as program binaries, keyed by the expanded sources and the driver.
+// 261018: Added loading with defines, and without waiting for drivers that compile in the background.
 
 //#define GL3_PROTOTYPES
 #include <stdlib.h>
@@ -19,6 +21,12 @@
 #include <stddef.h>
 #include <string.h>
 #include <fstream>
+#include <vector>
+#if defined(_WIN32)
+	#include <direct.h>
+#else
+	#include <sys/stat.h>
+#endif
 
 #include "GL_utilities.h"
 #include "Shadinclude.hpp"
@@ -106,11 +114,198 @@ void printProgramInfoLog(GLuint obj, const char *vfn, const char *ffn,
 	}
 }
 
+// Program binary cache
+// Every linked program is saved to a file named after a hash of its expanded
+// sources and the driver strings, so that later runs with the same shaders
+// and driver load it instead of compiling. Binaries the driver rejects, e.g.
+// after an update that kept the version string, are compiled again.
+
+#define PROGRAM_CACHE_MAGIC 0x42504C47 // "GLPB"
+
+typedef struct
+{
+	GLuint magic;
+	GLenum format;
+	GLint length;
+	unsigned long long hash;
+} ProgramCacheHeader;
+
+static const char *programCacheDir = "shaders/cache";
+
+void setProgramCacheDir(const char *dir)
+{
+	programCacheDir = dir;
+}
+
+// FNV-1a over the string and its terminator
+static unsigned long long hashString(unsigned long long hash, const char *s)
+{
+	do
+	{
+		hash ^= (unsigned char)*s;
+		hash *= 1099511628211ULL;
+	} while (*s++ != 0);
+	return hash;
+}
+
+// Hash of the specified sources, one per stage or NULL, and the driver
+static unsigned long long programHash(const char **sources, int count)
+{
+	unsigned long long hash = 14695981039346656037ULL;
+	for (int i = 0; i < count; i++)
+		hash = hashString(hash, sources[i] != NULL ? sources[i] : "");
+	hash = hashString(hash, (const char *)glGetString(GL_VENDOR));
+	hash = hashString(hash, (const char *)glGetString(GL_RENDERER));
+	hash = hashString(hash, (const char *)glGetString(GL_VERSION));
+	return hash;
+}
+
+static std::string programCachePath(unsigned long long hash)
+{
+	char name[32];
+	snprintf(name, sizeof(name), "/%016llx.bin", hash);
+	return std::string(programCacheDir) + name;
+}
+
+// Returns the cached program with the specified hash, or 0 if none loads
+static GLuint loadCachedProgram(unsigned long long hash)
+{
+	ProgramCacheHeader header;
+	GLint linked = GL_FALSE;
+	GLuint p;
+	char *binary;
+	FILE *fptr;
+
+	if (programCacheDir == NULL)
+		return 0;
+	fptr = fopen(programCachePath(hash).c_str(), "rb");
+	if (!fptr)
+		return 0;
+	if (fread(&header, sizeof(header), 1, fptr) != 1
+	 || header.magic != PROGRAM_CACHE_MAGIC || header.hash != hash || header.length <= 0)
+	{
+		fclose(fptr);
+		return 0;
+	}
+	binary = (char *)malloc(header.length);
+	if (fread(binary, header.length, 1, fptr) != 1)
+	{
+		free(binary);
+		fclose(fptr);
+		return 0;
+	}
+	fclose(fptr);
+
+	// Earlier errors are reported first, as those of a rejected binary are
+	// cleared below
+	printError("before loadCachedProgram");
+	p = glCreateProgram();
+	glProgramBinary(p, header.format, binary, header.length);
+	free(binary);
+	glGetProgramiv(p, GL_LINK_STATUS, &linked);
+	if (!linked)
+	{
+		glDeleteProgram(p);
+		while (glGetError() != GL_NO_ERROR)
+			; // An unknown format is an error, not just a failed link
+		return 0;
+	}
+	glUseProgram(p);
+	return p;
+}
+
+static void saveCachedProgram(GLuint p, unsigned long long hash)
+{
+	ProgramCacheHeader header;
+	GLint linked = GL_FALSE;
+	char *binary;
+	FILE *fptr;
+
+	if (programCacheDir == NULL)
+		return;
+	glGetProgramiv(p, GL_LINK_STATUS, &linked);
+	glGetProgramiv(p, GL_PROGRAM_BINARY_LENGTH, &header.length);
+	if (!linked || header.length <= 0)
+		return;
+	binary = (char *)malloc(header.length);
+	glGetProgramBinary(p, header.length, NULL, &header.format, binary);
+	header.magic = PROGRAM_CACHE_MAGIC;
+	header.hash = hash;
+
+	#if defined(_WIN32)
+		_mkdir(programCacheDir);
+	#else
+		mkdir(programCacheDir, 0755);
+	#endif
+	fptr = fopen(programCachePath(hash).c_str(), "wb");
+	if (fptr)
+	{
+		fwrite(&header, sizeof(header), 1, fptr);
+		fwrite(binary, header.length, 1, fptr);
+		fclose(fptr);
+	}
+	free(binary);
+}
+
+// Programs linked without waiting, finished by programReady
+typedef struct
+{
+	GLuint p;
+	GLuint shaders[5]; // 0 for missing stages
+	std::string fileNames[5];
+	unsigned long long hash;
+} PendingProgram;
+
+static std::vector<PendingProgram> pendingPrograms;
+
+// Whether the driver compiles and links in the background, so that the
+// completion of a program can be polled without blocking
+static int hasParallelCompile(void)
+{
+	static int supported = -1;
+	GLint count = 0;
+
+	if (supported >= 0)
+		return supported;
+	supported = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+	for (GLint i = 0; i < count; i++)
+	{
+		const char *name = (const char *)glGetStringi(GL_EXTENSIONS, i);
+		if (strcmp(name, "GL_ARB_parallel_shader_compile") == 0)
+			supported = 1;
+	}
+	if (supported)
+		glMaxShaderCompilerThreadsARB(0xFFFFFFFF); // As many as the driver likes
+	return supported;
+}
+
+// Prints the logs of a linked program and caches it
+static void finishProgram(GLuint p, const GLuint *shaders, const char **fileNames, unsigned long long hash)
+{
+	for (int i = 0; i < 5; i++)
+		if (shaders[i] != 0)
+			printShaderInfoLog(shaders[i], fileNames[i]);
+
+	printProgramInfoLog(p, fileNames[0], fileNames[1], fileNames[2], fileNames[3], fileNames[4]);
+
+	saveCachedProgram(p, hash);
+}
+
 // Compile a shader, return reference to it
+// Unless wait is set, returns while the driver still compiles if it can do
+// so in the background, see programReady.
 GLuint compileShaders(const char *vs, const char *fs, const char *gs, const char *tcs, const char *tes,
-								const char *vfn, const char *ffn, const char *gfn, const char *tcfn, const char *tefn)
+								const char *vfn, const char *ffn, const char *gfn, const char *tcfn, const char *tefn,
+								int wait)
 {
-	GLuint v,f,g,tc,te,p;
+	GLuint v,f,g = 0,tc = 0,te = 0,p;
+
+	const char *sources[] = {vs, fs, gs, tcs, tes};
+	unsigned long long hash = programHash(sources, 5);
+	p = loadCachedProgram(hash);
+	if (p != 0)
+		return p;
 
 	v = glCreateShader(GL_VERTEX_SHADER);
 	f = glCreateShader(GL_FRAGMENT_SHADER);
@@ -147,18 +342,66 @@ GLuint compileShaders(const char *vs, const char *fs, const char *gs, const char
 		glAttachShader(p,tc);
 	if (tes != NULL)
 		glAttachShader(p,te);
+	glProgramParameteri(p, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 	glLinkProgram(p);
+
+	GLuint shaders[5] = {v, f, g, tc, te};
+	const char *fileNames[5] = {vfn, ffn, gfn, tcfn, tefn};
+	if (!wait && hasParallelCompile())
+	{
+		PendingProgram pending;
+		pending.p = p;
+		pending.hash = hash;
+		for (int i = 0; i < 5; i++)
+		{
+			pending.shaders[i] = shaders[i];
+			pending.fileNames[i] = fileNames[i] != NULL ? fileNames[i] : "";
+		}
+		pendingPrograms.push_back(pending);
+		return p;
+	}
+
 	glUseProgram(p);
+	finishProgram(p, shaders, fileNames, hash);
+	return p;
+}
 
-	printShaderInfoLog(v, vfn);
-	printShaderInfoLog(f, ffn);
-	if (gs != NULL)	printShaderInfoLog(g, gfn);
-	if (tcs != NULL)	printShaderInfoLog(tc, tcfn);
-	if (tes != NULL)	printShaderInfoLog(te, tefn);
+int programReady(GLuint p)
+{
+	for (size_t i = 0; i < pendingPrograms.size(); i++)
+	{
+		PendingProgram &pending = pendingPrograms[i];
+		if (pending.p != p)
+			continue;
+
+		GLint completed = GL_FALSE;
+		glGetProgramiv(p, GL_COMPLETION_STATUS_ARB, &completed);
+		if (!completed)
+			return 0;
+
+		const char *fileNames[5];
+		for (int j = 0; j < 5; j++)
+			fileNames[j] = pending.shaders[j] != 0 ? pending.fileNames[j].c_str() : NULL;
+		finishProgram(p, pending.shaders, fileNames, pending.hash);
+		pendingPrograms.erase(pendingPrograms.begin() + i);
+		break;
+	}
 
-	printProgramInfoLog(p, vfn, ffn, gfn, tcfn, tefn);
+	GLint linked = GL_FALSE;
+	glGetProgramiv(p, GL_LINK_STATUS, &linked);
+	return linked ? 1 : -1;
+}
 
-	return p;
+// Inserts the specified lines after the #version line, which must come first
+static void insertDefines(std::string &source, const char *defines)
+{
+	if (defines == NULL || source.empty())
+		return;
+	size_t pos = source.compare(0, 8, "#version") == 0 ? source.find('\n') : std::string::npos;
+	if (pos == std::string::npos)
+		source.insert(0, std::string(defines) + "\n");
+	else
+		source.insert(pos + 1, std::string(defines) + "\n");
 }
 
 GLuint loadShaders(const char *vertFileName, const char *fragFileName)
@@ -175,6 +418,18 @@ GLuint loadShadersG(const char *vertFileName, const char *fragFileName, const ch
 GLuint loadShadersGT(const char *vertFileName, const char *fragFileName, const char *geomFileName,
 						const char *tcFileName, const char *teFileName)
 // With tesselation shader support
+{
+	return loadShadersGTD(vertFileName, fragFileName, geomFileName, tcFileName, teFileName, NULL, 1);
+}
+
+GLuint loadShadersDefines(const char *vertFileName, const char *fragFileName, const char *defines, int wait)
+{
+	return loadShadersGTD(vertFileName, fragFileName, NULL, NULL, NULL, defines, wait);
+}
+
+GLuint loadShadersGTD(const char *vertFileName, const char *fragFileName, const char *geomFileName,
+						const char *tcFileName, const char *teFileName, const char *defines, int wait)
+// With defines
 {
 	GLuint p = 0;
 
@@ -214,12 +469,54 @@ GLuint loadShadersGT(const char *vertFileName, const char *fragFileName, const c
 	} else
 		writeFile(tes, teFileName, extension);
 
+	// The files written above are the same for every set of defines
+	insertDefines(vs, defines);
+	insertDefines(fs, defines);
+	insertDefines(gs, defines);
+	insertDefines(tcs, defines);
+	insertDefines(tes, defines);
+
 	if (!vs.empty() && !fs.empty())
 		p = compileShaders(vs.c_str(), fs.c_str(),
 			 gs.empty() ? NULL : gs.c_str(),
 			tcs.empty() ? NULL : tcs.c_str(),
 			tes.empty() ? NULL : tes.c_str(),
-			vertFileName, fragFileName, geomFileName, tcFileName, teFileName);
+			vertFileName, fragFileName, geomFileName, tcFileName, teFileName, wait);
+	return p;
+}
+
+GLuint loadComputeShader(const char *compFileName)
+// Compute shader as a program of its own
+{
+	GLuint c, p;
+
+	std::string cs = Shadinclude::load(compFileName);
+	if (cs.empty())
+	{
+		fprintf(stderr, "Failed to read %s from disk.\n", compFileName);
+		return 0;
+	}
+	writeFile(cs, compFileName, ".out");
+
+	const char *source = cs.c_str();
+	unsigned long long hash = programHash(&source, 1);
+	p = loadCachedProgram(hash);
+	if (p != 0)
+		return p;
+
+	c = glCreateShader(GL_COMPUTE_SHADER);
+	glShaderSource(c, 1, &source, NULL);
+	glCompileShader(c);
+	p = glCreateProgram();
+	glAttachShader(p, c);
+	glProgramParameteri(p, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	glLinkProgram(p);
+	glUseProgram(p);
+
+	printShaderInfoLog(c, compFileName);
+	printProgramInfoLog(p, compFileName, "", NULL, NULL, NULL);
+
+	saveCachedProgram(p, hash);
 	return p;
 }
 
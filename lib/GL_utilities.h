@@ -22,6 +22,16 @@ GLuint loadShaders(const char *vertFileName, const char *fragFileName);
 GLuint loadShadersG(const char *vertFileName, const char *fragFileName, const char *geomFileName);
 GLuint loadShadersGT(const char *vertFileName, const char *fragFileName, const char *geomFileName,
 						const char *tcFileName, const char *teFileName);
+GLuint loadShadersGTD(const char *vertFileName, const char *fragFileName, const char *geomFileName,
+						const char *tcFileName, const char *teFileName, const char *defines, int wait);
+// Defines, or NULL, are inserted after the #version line of every stage.
+// Unless wait is set, returns while the driver still compiles if it can do
+// so in the background, and programReady must return 1 before use.
+GLuint loadShadersDefines(const char *vertFileName, const char *fragFileName, const char *defines, int wait);
+// 1 once linked, 0 while still compiling in the background, -1 if the link failed
+int programReady(GLuint p);
+GLuint loadComputeShader(const char *compFileName);
+void setProgramCacheDir(const char *dir); // NULL disables the program binary cache
 void dumpInfo(void);
 
 // This is obsolete! Use the functions in MicroGlut instead!
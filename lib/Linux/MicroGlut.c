@@ -36,6 +36,7 @@
 // 170410: Modified glutWarpPointer to make it more robust. Commended out some unused variables to avoid warnings.
 // 180124: Modifications to make it work better on recent MESA, which seems to have introduced some changes. Adds glFlush() in glutSwapBuffers and a timer when starting glutMain to invoke an update after 100 ms.
 // 180208: Added GLUT_WINDOW_WIDTH, GLUT_WINDOW_HEIGHT, GLUT_MOUSE_POSITION_X and GLUT_MOUSE_POSITION_Y to GlutGet. They were already in the Mac version, so let's converge the versions a bit.
+// 261018: The main loop blocks on the X connection while nothing is to be drawn, until an event arrives or a timer is due, instead of polling. Expose triggers an update.
 
 #define _DEFAULT_SOURCE
 #include <math.h>
@@ -49,6 +50,7 @@
 #include <X11/keysym.h>
 #include <GL/glx.h>
 #include "MicroGlut.h"
+#include <sys/select.h>
 #include <sys/time.h>
 #include <unistd.h>
 
@@ -482,8 +484,9 @@ void glutMainLoop()
 					gRunning = 0;
 				break;
 			case Expose:
-//			op = 1;
-				break; // Update event! Should do draw here.
+				if (event.xexpose.count == 0)
+					animate = 1;
+				break;
 			case ConfigureNotify:
 				if (gReshape)
 					gReshape(event.xconfigure.width, event.xconfigure.height);
@@ -645,6 +648,22 @@ void glutRepeatingTimer(int millis)
 	gTimers = t;
 }
 
+// Blocks until an X event is available or timeoutMillis has passed, forever if negative
+static void waitForEvents(int timeoutMillis)
+{
+	fd_set fds;
+	struct timeval tv;
+	int fd = ConnectionNumber(dpy);
+
+	if (XPending(dpy) > 0) // Also flushes the output buffer
+		return;
+	FD_ZERO(&fds);
+	FD_SET(fd, &fds);
+	tv.tv_sec = timeoutMillis / 1000;
+	tv.tv_usec = (timeoutMillis % 1000) * 1000;
+	select(fd + 1, &fds, NULL, NULL, timeoutMillis < 0 ? NULL : &tv);
+}
+
 static void checktimers()
 {
 	if (gTimers != NULL)
@@ -684,17 +703,22 @@ static void checktimers()
 				free(firethis);
 			}
 		}
-		// Otherwise, sleep until any timer should fire
+		// Otherwise, wait until any timer should fire or an event arrives
 		if (!animate)
 			if (nextTime > now)
 			{
-				usleep((nextTime - now)*1000);
+				waitForEvents(nextTime - now);
 			}
 	}
 	else
-// If no timer and no update, sleep a little to keep CPU load low
+// If no timer and no update, wait for the next event, or only sleep a little if there is an idle function to call
 		if (!animate)
-			usleep(10);
+		{
+			if (gIdle)
+				usleep(10);
+			else
+				waitForEvents(-1);
+		}
 }
 
 void glutInitContextVersion(int major, int minor)
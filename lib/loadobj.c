@@ -227,7 +227,7 @@ static void SkipToCRLF()
 
 static void ReadOneVertex(MeshPtr theMesh)
 {
-	GLfloat x, y, z;
+	GLfloat x = 0, y = 0, z = 0;
 	int tokenType;
 
 	// Three floats expected
@@ -256,7 +256,7 @@ static void ReadOneVertex(MeshPtr theMesh)
 static void ReadOneTexture(MeshPtr theMesh)
 {
 	int tokenType;
-	GLfloat s, t;
+	GLfloat s = 0, t = 0;
 
 	// Two floats expected
 	OBJGetToken(&tokenType);
@@ -280,7 +280,7 @@ static void ReadOneTexture(MeshPtr theMesh)
 static void ReadOneNormal(MeshPtr theMesh)
 {
 	int tokenType;
-	GLfloat x, y, z;
+	GLfloat x = 0, y = 0, z = 0;
 
 	// Three floats expected
 	OBJGetToken(&tokenType);
@@ -576,7 +576,7 @@ static struct Mesh * LoadOBJ(const char *filename)
 void DecomposeToTriangles(struct Mesh *theMesh)
 {
 	int i, vertexCount, triangleCount;
-	int *newCoords, *newNormalsIndex, *newTextureIndex;
+	int *newCoords, *newNormalsIndex = NULL, *newTextureIndex = NULL;
 	int newIndex = 0; // Index in newCoords
 	int first = 0;
 
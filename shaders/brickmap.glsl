@@ -0,0 +1,53 @@
+#ifndef BRICKMAP_GLSL
+#define BRICKMAP_GLSL
+
+#include aabb.glsl
+#include materials.glsl
+
+// Must match src/brickmap.hpp
+#define BRICKMAP_CELLS_BINDING 1
+#define BRICKMAP_POOL_BINDING  2
+#define BRICK_SHIFT  3
+#define BRICK_SIZE   (1 << BRICK_SHIFT)
+#define BRICK_VOXELS (BRICK_SIZE * BRICK_SIZE * BRICK_SIZE)
+#define BRICK_UNIFORM_BIT 0x80000000u
+
+// One cell per brick of the grid. Uniform cells have the uniform bit set and
+// their voxel value in the low byte. Other cells hold the index of their
+// brick in the pool, which packs 4 voxels per uint in [z][y][x] order.
+layout(std430, binding = BRICKMAP_CELLS_BINDING) readonly buffer BrickmapCells {
+	uint brickmap_cells[];
+};
+layout(std430, binding = BRICKMAP_POOL_BINDING) readonly buffer BrickmapPool {
+	uint brick_pool[];
+};
+
+/**
+ * Returns the value of the specified voxel and sets the voxel bounds of its
+ * brick if uniform, or else of the voxel itself, to the region parameters.
+ * Voxels outside the grid are void.
+ */
+int getBrickmapRegion(ivec3 voxel_coords, out ivec3 region_lo, out ivec3 region_hi) {
+	int value = STD_VOID_INDEX;
+	region_lo = region_hi = voxel_coords;
+
+	if (isInAABBi(voxel_coords, AABBi(ivec3(0), voxel_count - ivec3(1)))) {
+		ivec3 cell = voxel_coords >> BRICK_SHIFT;
+		ivec3 cell_count = (voxel_count + ivec3(BRICK_SIZE - 1)) >> BRICK_SHIFT;
+		uint entry = brickmap_cells[(cell.z * cell_count.y + cell.y) * cell_count.x + cell.x];
+
+		if ((entry & BRICK_UNIFORM_BIT) != 0u) {
+			value = int(entry & 0xFFu);
+			region_lo = cell << BRICK_SHIFT;
+			region_hi = min(region_lo + ivec3(BRICK_SIZE - 1), voxel_count - ivec3(1));
+		} else {
+			ivec3 local = voxel_coords & ivec3(BRICK_SIZE - 1);
+			int i = (local.z * BRICK_SIZE + local.y) * BRICK_SIZE + local.x;
+			uint word = brick_pool[entry * uint(BRICK_VOXELS / 4) + uint(i >> 2)];
+			value = int((word >> uint(8 * (i & 3))) & 0xFFu);
+		}
+	}
+	return value;
+}
+
+#endif // BRICKMAP_GLSL
@@ -0,0 +1,16 @@
+#ifndef CAMERA_GLSL
+#define CAMERA_GLSL
+
+// Must match CAMERA_BLOCK_BINDING in src/camera-block.hpp
+#define CAMERA_BLOCK_BINDING 0
+
+// Set once per frame by CameraBlock in src/camera-block.cpp, and shared by
+// every program tracing primary rays
+layout(std140, row_major, binding = CAMERA_BLOCK_BINDING) uniform CameraBlock {
+	mat4  camera_to_world_matrix;
+	vec3  view_pos;
+	float screen_ratio;
+	vec2  pixel_jitter; // Sub-pixel sample offset, in normalized device coordinates
+};
+
+#endif // CAMERA_GLSL
@@ -0,0 +1,23 @@
+#ifndef DISTANCE_FIELD_GLSL
+#define DISTANCE_FIELD_GLSL
+
+#include materials.glsl
+
+/**
+ * Returns the value of the specified voxel and sets the voxel bounds of the
+ * void cube around it, given by its distance to the nearest non-void voxel,
+ * to the region parameters. The region is clamped to the grid.
+ */
+int getDistanceFieldRegion(ivec3 voxel_coords, out ivec3 region_lo, out ivec3 region_hi) {
+	vec3 tex_coords = (vec3(voxel_coords) + vec3(0.5)) / vec3(voxel_count);
+	int value = int(round(255 * texture(voxel_tex, tex_coords).x));
+	int reach = max(int(texture(voxel_distance_tex, tex_coords).x) - 1, 0);
+	if (value != STD_VOID_INDEX) {
+		reach = 0;
+	}
+	region_lo = max(voxel_coords - ivec3(reach), ivec3(0));
+	region_hi = min(voxel_coords + ivec3(reach), voxel_count - ivec3(1));
+	return value;
+}
+
+#endif // DISTANCE_FIELD_GLSL
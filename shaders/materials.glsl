@@ -1,9 +1,12 @@
 #ifndef MATERIALS_GLSL
 #define MATERIALS_GLSL
 
-#define MATERIAL_COUNT 4
 #define STD_VOID_INDEX 0
 
+// Must match MATERIALS_BINDING in src/materials.hpp
+#define MATERIALS_BINDING 3
+
+// Laid out as MaterialProperties in src/materials.hpp
 struct Material {
 	vec3  color;
 	float diffusivity;
@@ -13,11 +16,9 @@ struct Material {
 	float refraction_index;
 };
 
-Material materials[MATERIAL_COUNT] = {
-	Material(vec3(0.0), 0.0, 0.0, 0.0, 1.0, 1.0), // Void
-	Material(vec3(1.0), 0.2, 0.7, 0.3, 0.8, 1.5), // Glass
-	Material(vec3(1.0), 0.6, 0.5, 0.2, 0.0, 1.0), // Solid
-	Material(vec3(1.0), 0.5, 0.7, 0.3, 0.2, 1.5)  // Semi-solid
+// Indexed by voxel value, uploaded by uploadMaterials in src/materials.cpp
+layout(std430, binding = MATERIALS_BINDING) readonly buffer material_buffer {
+	Material materials[];
 };
 
 #endif // MATERIALS_GLSL
@@ -0,0 +1,44 @@
+#ifndef OCTREE_GLSL
+#define OCTREE_GLSL
+
+#include materials.glsl
+
+// Must match src/octree.hpp
+#define OCTREE_BINDING 0
+#define OCTREE_LEAF_BIT 0x80000000u
+
+// Sparse voxel octree with the root at index 0. Uniform nodes have the leaf
+// bit set and their voxel value in the low byte. Other nodes hold the index
+// of their first child, with all 8 children stored in x + 2y + 4z order.
+layout(std430, binding = OCTREE_BINDING) readonly buffer OctreeNodes {
+	uint octree_nodes[];
+};
+
+/**
+ * Returns the value of the uniform octree node containing the specified
+ * voxel and sets the voxel bounds of said node to the region parameters.
+ * Voxels outside the root node are void.
+ */
+int getOctreeRegion(ivec3 voxel_coords, out ivec3 region_lo, out ivec3 region_hi) {
+	int size = 1 << octree_levels;
+	uint node = octree_nodes[0];
+	ivec3 lo = ivec3(0);
+	for (int level = octree_levels; level > 0 && (node & OCTREE_LEAF_BIT) == 0u; --level) {
+		size >>= 1;
+		ivec3 child = ivec3(greaterThanEqual(voxel_coords, lo + ivec3(size)));
+		lo += child * size;
+		node = octree_nodes[node + uint(child.x + 2 * child.y + 4 * child.z)];
+	}
+
+	// Checked after the descent, as returning early from it miscompiles on
+	// some drivers
+	if (any(lessThan(voxel_coords, ivec3(0))) || any(greaterThanEqual(voxel_coords, ivec3(1 << octree_levels)))) {
+		region_lo = region_hi = voxel_coords;
+		return STD_VOID_INDEX;
+	}
+	region_lo = lo;
+	region_hi = lo + ivec3(size - 1);
+	return int(node & 0xFFu);
+}
+
+#endif // OCTREE_GLSL
@@ -2,11 +2,20 @@
 #define RAYCASTING_GLSL
 
 #include aabb.glsl
+#include brickmap.glsl
+#include distance-field.glsl
 #include materials.glsl
+#include octree.glsl
 #include utils.glsl
 
 #define VOXEL_WORLD_SKIN vec3(0.0001)
 
+// Voxel storage, must match VoxelStructure in src/voxel-generator.hpp
+#define VOXEL_STRUCTURE_GRID           0
+#define VOXEL_STRUCTURE_OCTREE         1
+#define VOXEL_STRUCTURE_DISTANCE_FIELD 2
+#define VOXEL_STRUCTURE_BRICKMAP       3
+
 // Ray with origin o, direction dir and inverse (1/dir) dir_inv
 struct Ray { vec3 o; vec3 dir; vec3 dir_inv; };
 
@@ -27,8 +36,28 @@ struct RaymarchVoxelHit {
 	float transparency;
 };
 
-int getVoxelValue(vec3 voxel_coords) {
-	return int(round(255 * texture(voxel_tex, voxel_coords / voxel_count).x));
+/**
+ * Returns the value of the specified voxel and sets the bounds of a region
+ * around it, where all voxels share said value, to the region parameters.
+ * The region is only the voxel itself for the plain grid.
+ */
+int getVoxelRegion(ivec3 voxel_coords, out ivec3 region_lo, out ivec3 region_hi) {
+	if (voxel_structure == VOXEL_STRUCTURE_OCTREE) {
+		return getOctreeRegion(voxel_coords, region_lo, region_hi);
+	}
+	if (voxel_structure == VOXEL_STRUCTURE_DISTANCE_FIELD) {
+		return getDistanceFieldRegion(voxel_coords, region_lo, region_hi);
+	}
+	if (voxel_structure == VOXEL_STRUCTURE_BRICKMAP) {
+		return getBrickmapRegion(voxel_coords, region_lo, region_hi);
+	}
+	region_lo = region_hi = voxel_coords;
+	return int(round(255 * texture(voxel_tex, (vec3(voxel_coords) + vec3(0.5)) / vec3(voxel_count)).x));
+}
+
+int getVoxelValue(ivec3 voxel_coords) {
+	ivec3 region_lo, region_hi;
+	return getVoxelRegion(voxel_coords, region_lo, region_hi);
 }
 
 /**
@@ -130,6 +159,10 @@ bool raymarchVoxels(const Ray r, out RaymarchVoxelHit hit, int start_value, floa
 	RaycastAABBHit aabb_hit;
 	if (!raycastAABB(r, aabb, aabb_hit)) {
 		// No intersection
+		if (hit_condition.type == HIT_CONDITION_OPAQUE) {
+			// Nothing in the way -- Fully transparent
+			hit = RaymarchVoxelHit(-1, -1, ivec3(0.0), vec3(0.0), 0.0, vec3(0.0), 0.0, 1.0);
+		}
 		return false;
 	}
 	depth = aabb_hit.depth;
@@ -153,12 +186,13 @@ bool raymarchVoxels(const Ray r, out RaymarchVoxelHit hit, int start_value, floa
 		while (depth < max_depth && isInAABBi(voxel_coords, voxel_bounds)) {
 
 			// Check voxel hit
-			int hit_value = getVoxelValue(vec3(voxel_coords) + vec3(0.5));
+			ivec3 region_lo, region_hi;
+			int hit_value = getVoxelRegion(voxel_coords, region_lo, region_hi);
 			if (isHitConditionMet(hit_condition, hit_value)) {
 				int draw_value = hit_value;
 				if (hit_value == STD_VOID_INDEX) {
 					// If exiting into actual void, draw previous material
-					draw_value = getVoxelValue(vec3(voxel_coords) + normal + vec3(0.5));
+					draw_value = getVoxelValue(voxel_coords + ivec3(normal));
 				}
 				float transparency = 0.0;
 				vec3 world_pos = r.o + depth * r.dir;
@@ -166,18 +200,30 @@ bool raymarchVoxels(const Ray r, out RaymarchVoxelHit hit, int start_value, floa
 				hit = RaymarchVoxelHit(hit_value, draw_value, voxel_coords, world_pos, depth, normal, refr_index_ratio, transparency);
 				return true;
 			}
+			min_transparency = min(min_transparency, materials[hit_value].refractivity);
+
+			// Skip to the last voxel of the region along the ray, since they
+			// all share the value of this one
+			if (region_lo != region_hi) {
+				ivec3 steps_left = mix(voxel_coords - region_lo, region_hi - voxel_coords, greaterThan(voxel_step, ivec3(0)));
+				// (Zero steps are masked, as depth_step is infinite along axes the ray is parallel to)
+				vec3 exit_depth = mix(next_depth + vec3(steps_left) * depth_step, next_depth, equal(steps_left, ivec3(0)));
+				float region_exit = min(min(exit_depth.x, exit_depth.y), exit_depth.z);
+				ivec3 crossings = ivec3(clamp(ceil((region_exit - next_depth) / depth_step), vec3(0.0), vec3(steps_left)));
+				crossings = mix(crossings, ivec3(0), greaterThanEqual(next_depth, vec3(region_exit)));
+				voxel_coords += crossings * voxel_step;
+				next_depth = mix(next_depth + vec3(crossings) * depth_step, next_depth, equal(crossings, ivec3(0)));
+			}
 
 			// Traverse to next voxel
 			if (next_depth.x <= next_depth.y) {
 				if (next_depth.x <= next_depth.z) {
-					min_transparency = min(min_transparency, materials[hit_value].refractivity);
 					depth = next_depth.x;
 					normal = vec3(-voxel_step.x, 0.0, 0.0);
 					voxel_coords.x += voxel_step.x;
 					next_depth.x += depth_step.x;
 				}
 				else {
-					min_transparency = min(min_transparency, materials[hit_value].refractivity);
 					depth = next_depth.z;
 					normal = vec3(0.0, 0.0, -voxel_step.z);
 					voxel_coords.z += voxel_step.z;
@@ -185,14 +231,12 @@ bool raymarchVoxels(const Ray r, out RaymarchVoxelHit hit, int start_value, floa
 				}
 			}
 			else if (next_depth.y <= next_depth.z) {
-				min_transparency = min(min_transparency, materials[hit_value].refractivity);
 				depth = next_depth.y;
-				normal = vec3(0.0, -voxel_step.y, 0.0);;
+				normal = vec3(0.0, -voxel_step.y, 0.0);
 				voxel_coords.y += voxel_step.y;
 				next_depth.y += depth_step.y;
 			}
 			else {
-				min_transparency = min(min_transparency, materials[hit_value].refractivity);
 				depth = next_depth.z;
 				normal = vec3(0.0, 0.0, -voxel_step.z);
 				voxel_coords.z += voxel_step.z;
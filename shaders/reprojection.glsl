@@ -0,0 +1,57 @@
+#ifndef REPROJECTION_GLSL
+#define REPROJECTION_GLSL
+
+// Must match HISTORY_*_TEXTURE_UNIT in src/reprojection.hpp, bound here as
+// samplers of different types may not share a unit
+#define HISTORY_DIRECT_TEXTURE_UNIT 3
+#define HISTORY_HIT_TEXTURE_UNIT    4
+
+// Frames in a row the direct light of a hit may be reused for before it is
+// shaded again. Its age is kept in the alpha of out_direct, 0 once shaded.
+#define REPROJECTION_MAX_AGE 8
+
+// Set by Reprojection in src/reprojection.cpp
+uniform bool temporal_reuse; // Reuse direct light of the last frame where it saw the same voxel face
+layout(binding = HISTORY_DIRECT_TEXTURE_UNIT) uniform sampler2D history_direct_tex; // Direct light of the last frame
+layout(binding = HISTORY_HIT_TEXTURE_UNIT) uniform sampler2D history_hit_tex;       // Primary hits of the last frame, see encodeHit
+uniform mat4  prev_world_to_camera;
+uniform vec3  prev_view_pos;
+uniform float prev_screen_ratio;
+uniform ivec2 prev_render_size; // Region of the history textures in use
+
+/**
+ * Returns the coordinates of the hit voxel and a code for the face hit, 1 to
+ * 7 by the axis and sign of the normal, or 0 if nothing was hit.
+ */
+vec4 encodeHit(bool has_hit, const RaymarchVoxelHit hit) {
+	return has_hit ? vec4(vec3(hit.voxel_coords), dot(hit.normal, vec3(1.0, 2.0, 3.0)) + 4.0) : vec4(0.0);
+}
+
+/**
+ * Projects the specified hit into the last frame and sets direct to the
+ * direct light of the primary hit of the pixel there, with its age in alpha
+ * increased by another frame. Returns false, with direct unset, if the hit
+ * was out of view, that pixel saw another voxel face or its direct light is
+ * REPROJECTION_MAX_AGE frames old.
+ */
+bool reprojectHit(const RaymarchVoxelHit hit, out vec4 direct) {
+	direct = vec4(0.0);
+	bool valid = false;
+
+	// The screen is the z = 0 plane of camera space, viewed from the eye
+	vec3 pos = vec3(prev_world_to_camera * vec4(hit.world_pos, 1.0));
+	vec3 eye = vec3(prev_world_to_camera * vec4(prev_view_pos, 1.0));
+	if (pos.z < eye.z) {
+		vec2 screen_pos = eye.xy + (eye.z / (eye.z - pos.z)) * (pos.xy - eye.xy);
+		vec2 ndc = vec2(screen_pos.x / prev_screen_ratio, screen_pos.y);
+		ivec2 pixel = ivec2(floor((0.5 * ndc + 0.5) * vec2(prev_render_size)));
+		if (all(greaterThanEqual(pixel, ivec2(0))) && all(lessThan(pixel, prev_render_size))) {
+			direct = texelFetch(history_direct_tex, pixel, 0);
+			direct.a += 1.0;
+			valid = texelFetch(history_hit_tex, pixel, 0) == encodeHit(true, hit) && direct.a <= REPROJECTION_MAX_AGE;
+		}
+	}
+	return valid;
+}
+
+#endif // REPROJECTION_GLSL
@@ -0,0 +1,42 @@
+#ifndef SHADING_GLSL
+#define SHADING_GLSL
+
+uniform float      min_ray_weight;
+uniform sampler3D  light_volume_tex; // Light visibility per cell, see src/light-volume.hpp
+uniform bool       baked_shadows;
+
+#define AMBIENT_LIGHT vec3(0.05, 0.075, 0.1)
+#define RECURSIVE_RAY_OFFSET 0.001
+
+// Quality settings, which may be defined by the program loader instead to
+// specialize a variant, see src/shader-variants.hpp
+#ifndef MAX_REFLECTION_DEPTH
+#define MAX_REFLECTION_DEPTH 4
+#endif
+#ifndef MAX_REFRACTION_DEPTH
+#define MAX_REFRACTION_DEPTH 4
+#endif
+
+// Must match LIGHTS_BINDING in src/lights.hpp
+#define LIGHTS_BINDING 4
+
+// Must match LIGHT_VOLUME_MAX_LIGHTS in src/light-volume.hpp
+#define LIGHT_VOLUME_MAX_LIGHTS 4
+
+// Laid out as PointLight in src/lights.hpp
+struct PointLight { vec3 pos; vec3 intensity; };
+
+// Uploaded by uploadLights in src/lights.cpp
+layout(std430, binding = LIGHTS_BINDING) readonly buffer light_buffer {
+	PointLight lights[];
+};
+
+// Lights shaded per hit. A defined LIGHT_COUNT, which must match the lights
+// uploaded, bounds the loops over them by a constant.
+#ifdef LIGHT_COUNT
+#define SHADED_LIGHT_COUNT LIGHT_COUNT
+#else
+#define SHADED_LIGHT_COUNT lights.length()
+#endif
+
+#endif // SHADING_GLSL
@@ -0,0 +1,13 @@
+#ifndef VOXEL_UNIFORMS_GLSL
+#define VOXEL_UNIFORMS_GLSL
+
+// Set by initVoxels or setVoxelUniforms in src/voxel-generator.cpp
+uniform sampler3D  voxel_tex;
+uniform usampler3D voxel_distance_tex;
+uniform float      voxel_density;
+uniform float      voxel_width;
+uniform ivec3      voxel_count;
+uniform int        voxel_structure;
+uniform int        octree_levels;
+
+#endif // VOXEL_UNIFORMS_GLSL
@@ -0,0 +1,76 @@
+#ifndef WAVEFRONT_GLSL
+#define WAVEFRONT_GLSL
+
+// Queues and state shared by the wavefront kernels, must match
+// src/wavefront-renderer.hpp
+#define WAVEFRONT_GROUP_SIZE      64
+#define RAY_QUEUE_IN_BINDING      5
+#define RAY_QUEUE_OUT_BINDING     6
+#define SHADOW_QUEUE_BINDING      7
+#define WAVEFRONT_STATE_BINDING   8
+#define ACCUMULATION_BINDING      9
+
+// Light is summed per pixel and channel in fixed point, as there are no float
+// atomics. Every term is clamped to 1 first, which leaves the clamped pixel
+// color unchanged since all terms are positive. 2^12 terms fit per pixel.
+#define ACCUMULATION_SCALE 1048576.0 // 2^20
+
+// Reflection or refraction ray waiting to be marched
+struct QueuedRay {
+	vec3  o;
+	int   pixel;
+	vec3  dir;
+	int   void_value;
+	vec3  primary_dir; // For specular highlights
+	float weight;      // Contribution to the pixel
+	int   recursion_depth;
+};
+
+// Shadow ray towards a light, adding contribution times the transparency
+// along the way to the pixel unless blocked
+struct ShadowRay {
+	vec3  o;
+	int   pixel;
+	vec3  dir;
+	float max_depth;
+	vec3  contribution;
+	int   void_value;
+};
+
+layout(std430, binding = RAY_QUEUE_IN_BINDING) buffer RayQueueIn {
+	QueuedRay rays_in[];
+};
+layout(std430, binding = RAY_QUEUE_OUT_BINDING) buffer RayQueueOut {
+	QueuedRay rays_out[];
+};
+layout(std430, binding = SHADOW_QUEUE_BINDING) buffer ShadowQueue {
+	ShadowRay shadow_rays[];
+};
+
+// Indirect dispatch sizes and queue counts. Counts may exceed the capacity
+// of their queue, in which case the rays past the end were dropped.
+layout(std430, binding = WAVEFRONT_STATE_BINDING) buffer WavefrontState {
+	uvec4 extend_groups;  // Dispatch size of the extend kernel
+	uvec4 shadow_groups;  // Dispatch size of the shadow kernel
+	uint  ray_count;      // Rays in rays_in
+	uint  next_ray_count; // Rays added to rays_out
+	uint  shadow_count;   // Rays added to shadow_rays
+	uint  ray_peak;       // Most rays added to rays_out in one bounce
+	uint  shadow_peak;    // Most rays added to shadow_rays in one bounce
+};
+
+layout(std430, binding = ACCUMULATION_BINDING) buffer Accumulation {
+	uint accumulation[]; // RGB per pixel, in units of 1 / ACCUMULATION_SCALE
+};
+
+/**
+ * Adds the specified light to the specified pixel.
+ */
+void accumulate(int pixel, vec3 light) {
+	uvec3 fixed_light = uvec3(clamp(light, vec3(0.0), vec3(1.0)) * ACCUMULATION_SCALE + vec3(0.5));
+	if (fixed_light.r > 0u) atomicAdd(accumulation[3 * pixel + 0], fixed_light.r);
+	if (fixed_light.g > 0u) atomicAdd(accumulation[3 * pixel + 1], fixed_light.g);
+	if (fixed_light.b > 0u) atomicAdd(accumulation[3 * pixel + 2], fixed_light.b);
+}
+
+#endif // WAVEFRONT_GLSL
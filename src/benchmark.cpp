@@ -0,0 +1,276 @@
+#include "benchmark.hpp"
+
+#include "brickmap.hpp"
+#include "camera-block.hpp"
+#include "camera.hpp"
+#include "cpu-renderer.hpp"
+#include "framebuffer.hpp"
+#include "gl-import.hpp"
+#include "gpu-timer.hpp"
+#include "headless.hpp"
+#include "parallel.hpp"
+#include "scene.hpp"
+#include "screen-quad.hpp"
+#include "shader-utils.hpp"
+#include "voxel-generator.hpp"
+#include "wavefront-renderer.hpp"
+
+#include "GL_utilities.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+
+//----------------------Constants----------------------------------------------
+
+#define BENCH_WARMUP_FRAMES 2  // Rendered but not timed, per run
+#define BENCH_FRAMES        24 // Timed frames per run
+
+struct BenchScene {
+	const char *name;
+	int grid_size;
+};
+
+struct BenchPath {
+	const char *name;
+	float x, y;         // Start rotation, as Camera
+	float zoom;         // Of the largest grid extent, default zoom if 0
+	float step_x, step_y; // Rotation per frame
+};
+
+static const BenchScene SCENES[] = {
+	{"test-16", 16},
+	{"test-64", 64},
+};
+
+static const VoxelStructure STRUCTURES[] = {
+	VoxelStructure::GRID,
+	VoxelStructure::OCTREE,
+	VoxelStructure::DISTANCE_FIELD,
+	VoxelStructure::BRICKMAP,
+};
+
+static const BenchPath PATHS[] = {
+	// One revolution around the grid
+	{"orbit", 0.2 * M_PI, -0.125 * M_PI, 0.0, 2.0 * M_PI / BENCH_FRAMES, 0.0},
+	// From below the grid to above it
+	{"sweep", 0.2 * M_PI, -0.45 * M_PI, 0.0, 0.0, 0.9 * M_PI / BENCH_FRAMES},
+	// One revolution from inside the grid
+	{"inside", 0.2 * M_PI, -0.125 * M_PI, 0.25, 2.0 * M_PI / BENCH_FRAMES, 0.0},
+};
+
+
+//----------------------Implementation-----------------------------------------
+
+static const char *structureName(VoxelStructure structure) {
+	switch (structure) {
+	case VoxelStructure::OCTREE:         return "octree";
+	case VoxelStructure::DISTANCE_FIELD: return "distance";
+	case VoxelStructure::BRICKMAP:       return "brickmap";
+	default:                             return "grid";
+	}
+}
+
+/**
+ * Returns the nearest-rank percentile of the specified sorted values.
+ */
+static double percentile(const std::vector<double> &sorted, double p) {
+	int rank = (int)std::ceil(0.01 * p * sorted.size());
+	return sorted[std::max(rank, 1) - 1];
+}
+
+/**
+ * Follows the specified path with a fresh camera, calling renderFrame for
+ * every frame, and writes the timings of the run to out as a JSON object,
+ * including the mean time of every pass measured by gpu_timer if set.
+ */
+static void runPath(FILE *out, const Options &options, const BenchScene &scene,
+                    VoxelStructure structure, const BenchPath &path, ivec3 grid_size,
+                    GpuTimer *gpu_timer,
+                    const std::function<void(const Camera &)> &renderFrame)
+{
+	using Clock = std::chrono::steady_clock;
+
+	Camera camera(path.x, path.y, grid_size);
+	if (path.zoom > 0.0) {
+		camera.setZoom(path.zoom * std::max(std::max(grid_size.x, grid_size.y), grid_size.z) * VOXEL_WIDTH);
+	}
+
+	std::vector<double> frame_ms;
+	for (int frame = 0; frame < BENCH_WARMUP_FRAMES + BENCH_FRAMES; ++frame) {
+		if (frame > BENCH_WARMUP_FRAMES) {
+			camera.orbit(path.step_x, path.step_y);
+		}
+		if (frame == BENCH_WARMUP_FRAMES && gpu_timer != NULL) {
+			gpu_timer->endFrame(true);
+			gpu_timer->resetStats();
+		}
+		Clock::time_point start = Clock::now();
+		renderFrame(camera);
+		double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		if (frame >= BENCH_WARMUP_FRAMES) {
+			frame_ms.push_back(ms);
+		}
+	}
+	if (gpu_timer != NULL) gpu_timer->endFrame(true);
+
+	std::vector<double> sorted = frame_ms;
+	std::sort(sorted.begin(), sorted.end());
+	double total_ms = 0.0;
+	for (double ms : frame_ms) total_ms += ms;
+	double mean_ms = total_ms / frame_ms.size();
+	double rays_per_second = 1000.0 * options.width * options.height * frame_ms.size() / total_ms;
+
+	printf("%-8s %-9s %-7s mean %9.3f  p50 %9.3f  p95 %9.3f  p99 %9.3f ms  %8.3f Mrays/s\n",
+	       scene.name, structureName(structure), path.name, mean_ms,
+	       percentile(sorted, 50.0), percentile(sorted, 95.0), percentile(sorted, 99.0),
+	       1e-6 * rays_per_second);
+
+	fprintf(out, "    {\n");
+	fprintf(out, "      \"scene\": \"%s\",\n", scene.name);
+	fprintf(out, "      \"structure\": \"%s\",\n", structureName(structure));
+	fprintf(out, "      \"path\": \"%s\",\n", path.name);
+	fprintf(out, "      \"frame_ms\": [");
+	for (size_t i = 0; i < frame_ms.size(); ++i) {
+		fprintf(out, "%s%.4f", i > 0 ? ", " : "", frame_ms[i]);
+	}
+	fprintf(out, "],\n");
+	fprintf(out, "      \"mean_ms\": %.4f,\n", mean_ms);
+	fprintf(out, "      \"p50_ms\": %.4f,\n", percentile(sorted, 50.0));
+	fprintf(out, "      \"p95_ms\": %.4f,\n", percentile(sorted, 95.0));
+	fprintf(out, "      \"p99_ms\": %.4f,\n", percentile(sorted, 99.0));
+	if (gpu_timer != NULL) {
+		fprintf(out, "      \"gpu_pass_ms\": {");
+		const std::vector<GpuPassStats> &passes = gpu_timer->getStats();
+		for (size_t i = 0; i < passes.size(); ++i) {
+			fprintf(out, "%s\"%s\": %.4f", i > 0 ? ", " : "", passes[i].name.c_str(), passes[i].meanMs());
+		}
+		fprintf(out, "},\n");
+	}
+	fprintf(out, "      \"rays_per_second\": %.1f\n", rays_per_second);
+	fprintf(out, "    }");
+}
+
+int runBenchmark(const Options &options) {
+	GLuint shader = 0;
+	Model *square_model = NULL;
+	WavefrontRenderer wavefront_renderer; // With --wavefront
+	CameraBlock camera_block;
+	GpuTimer gpu_timer;
+	std::string device;
+
+	if (options.cpu) {
+		device = std::to_string(threadCount()) + " CPU threads";
+	} else {
+		if (!initHeadlessContext()) {
+			return 1;
+		}
+		FBOstruct *fbo = initFBO2(options.width, options.height, 0, 0);
+		glBindFramebuffer(GL_FRAMEBUFFER, fbo->fb);
+		glViewport(0, 0, options.width, options.height);
+
+		if (options.wavefront) {
+			if (!wavefront_renderer.init()) {
+				return 1;
+			}
+			wavefront_renderer.setMinRayWeight(options.min_ray_weight);
+			wavefront_renderer.resize(options.width, options.height);
+		} else {
+			shader = loadShaders("shaders/raytracing.vert", "shaders/raytracing.frag");
+			glUseProgram(shader);
+			square_model = createScreenQuad();
+			glUniform1f(uniformLoc(shader, "min_ray_weight"), options.min_ray_weight);
+		}
+		printError("init benchmark");
+		device = (const char *)glGetString(GL_RENDERER);
+	}
+
+	FILE *out = fopen(options.bench.c_str(), "w");
+	if (out == NULL) {
+		fprintf(stderr, "Failed to write %s\n", options.bench.c_str());
+		return 1;
+	}
+	fprintf(out, "{\n");
+	fprintf(out, "  \"renderer\": \"%s\",\n", options.cpu ? "cpu" : options.wavefront ? "wavefront" : "gpu");
+	fprintf(out, "  \"device\": \"%s\",\n", device.c_str());
+	fprintf(out, "  \"width\": %d,\n", options.width);
+	fprintf(out, "  \"height\": %d,\n", options.height);
+	fprintf(out, "  \"min_ray_weight\": %g,\n", options.min_ray_weight);
+	fprintf(out, "  \"layout\": \"%s\",\n", options.layout == VoxelLayout::MORTON ? "morton" : "linear");
+	fprintf(out, "  \"warmup_frames\": %d,\n", BENCH_WARMUP_FRAMES);
+	fprintf(out, "  \"frames\": %d,\n", BENCH_FRAMES);
+	fprintf(out, "  \"runs\": [\n");
+
+	bool first_run = true;
+	for (const BenchScene &scene : SCENES) {
+		Options scene_options;
+		scene_options.grid_size = ivec3(scene.grid_size);
+		VoxelGrid voxels = createScene(scene_options);
+
+		for (VoxelStructure structure : STRUCTURES) {
+			// The CPU only traverses the grid and the brickmap
+			if (options.cpu && structure != VoxelStructure::GRID && structure != VoxelStructure::BRICKMAP) {
+				continue;
+			}
+
+			Brickmap brickmap;
+			MortonGrid morton;
+			CpuRenderer renderer;
+			Framebuffer framebuffer(options.width, options.height);
+			if (options.cpu) {
+				if (structure == VoxelStructure::BRICKMAP) {
+					brickmap = Brickmap(voxels);
+				}
+				renderer = CpuRenderer(voxels, structure == VoxelStructure::BRICKMAP ? &brickmap : nullptr);
+				if (structure == VoxelStructure::GRID && options.layout == VoxelLayout::MORTON) {
+					morton = MortonGrid(voxels);
+					renderer.setMortonGrid(&morton);
+				}
+				renderer.setMinRayWeight(options.min_ray_weight);
+			} else if (options.wavefront) {
+				wavefront_renderer.setVoxels(voxels, structure);
+				printError("init benchmark voxels");
+			} else {
+				initVoxels(shader, voxels, structure);
+				printError("init benchmark voxels");
+			}
+
+			for (const BenchPath &path : PATHS) {
+				fprintf(out, first_run ? "" : ",\n");
+				first_run = false;
+				runPath(out, options, scene, structure, path, voxels.size,
+				        options.cpu ? NULL : &gpu_timer, [&](const Camera &camera) {
+					if (options.cpu) {
+						renderer.render(camera.getCameraToWorldMatrix(), camera.getViewPos(), framebuffer);
+						return;
+					}
+					camera_block.upload(camera, (GLfloat) options.width / (GLfloat) options.height,
+					                    vec2(0.0, 0.0), options.width, options.height);
+					if (options.wavefront) {
+						wavefront_renderer.render(&gpu_timer);
+						glFinish();
+						gpu_timer.endFrame();
+					} else {
+						glClear(GL_COLOR_BUFFER_BIT);
+						gpu_timer.beginPass("raytrace");
+						DrawModel(square_model, shader, "in_pos", NULL, NULL);
+						gpu_timer.endPass("raytrace");
+						glFinish();
+						gpu_timer.endFrame();
+					}
+				});
+			}
+		}
+	}
+
+	fprintf(out, "\n  ]\n}\n");
+	fclose(out);
+	printError("benchmark");
+	printf("Wrote %s\n", options.bench.c_str());
+	return 0;
+}
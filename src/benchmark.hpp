@@ -0,0 +1,19 @@
+#ifndef BENCHMARK_HPP
+#define BENCHMARK_HPP
+
+#include "options.hpp"
+
+
+/**
+ * Renders a fixed suite of scenes, voxel structures and scripted camera paths
+ * offscreen, on the CPU if options.cpu is set or else on the GPU, at the
+ * options' frame size. Writes per-frame times, their mean and percentiles,
+ * the mean GPU time of every render pass and primary rays per second of every
+ * run to options.bench as JSON. Scene, grid
+ * and camera options are ignored so that results stay comparable.
+ *
+ * Returns the process exit code.
+ */
+int runBenchmark(const Options &options);
+
+#endif // BENCHMARK_HPP
@@ -0,0 +1,158 @@
+#include "brickmap.hpp"
+
+#include "materials.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+
+//----------------------Implementation-----------------------------------------
+
+static int brickVoxelIndex(int x, int y, int z) {
+	return (z * BRICK_SIZE + y) * BRICK_SIZE + x;
+}
+
+/**
+ * Returns the value shared by all voxels of the brick, or -1 if mixed.
+ */
+static int uniformValue(const GLubyte *voxels) {
+	for (int i = 1; i < BRICK_VOXELS; ++i) {
+		if (voxels[i] != voxels[0]) return -1;
+	}
+	return voxels[0];
+}
+
+Brickmap::Brickmap(const VoxelGrid &grid)
+	: size{grid.size}, cells_buffer{0}, pool_buffer{0}, uploaded_capacity{0}
+{
+	cell_count = ivec3((size.x + BRICK_SIZE - 1) >> BRICK_SHIFT,
+	                   (size.y + BRICK_SIZE - 1) >> BRICK_SHIFT,
+	                   (size.z + BRICK_SIZE - 1) >> BRICK_SHIFT);
+	int total_cells = cell_count.x * cell_count.y * cell_count.z;
+	cells.resize(total_cells);
+
+	// Classify the bricks in parallel, keeping the voxels of mixed ones
+	std::vector<std::vector<GLubyte>> mixed(total_cells);
+	parallelFor(cell_count.z, [&](int z) {
+		GLubyte voxels[BRICK_VOXELS];
+		for (int y = 0; y < cell_count.y; ++y) {
+			for (int x = 0; x < cell_count.x; ++x) {
+				int i = cellIndex(ivec3(x, y, z));
+				readBrick(ivec3(x, y, z), grid, voxels);
+				int value = uniformValue(voxels);
+				if (value >= 0) {
+					cells[i] = BRICK_UNIFORM_BIT | (GLuint)value;
+				} else {
+					mixed[i].assign(voxels, voxels + BRICK_VOXELS);
+				}
+			}
+		}
+	});
+
+	// Pack the mixed bricks into the pool in cell order
+	for (int i = 0; i < total_cells; ++i) {
+		if (!mixed[i].empty()) {
+			cells[i] = pool.size() / BRICK_VOXELS;
+			pool.insert(pool.end(), mixed[i].begin(), mixed[i].end());
+		}
+	}
+}
+
+void Brickmap::readBrick(ivec3 cell, const VoxelGrid &grid, GLubyte *voxels) const {
+	ivec3 lo = ivec3(cell.x << BRICK_SHIFT, cell.y << BRICK_SHIFT, cell.z << BRICK_SHIFT);
+	for (int z = 0; z < BRICK_SIZE; ++z) {
+		for (int y = 0; y < BRICK_SIZE; ++y) {
+			for (int x = 0; x < BRICK_SIZE; ++x) {
+				ivec3 voxel = ivec3(lo.x + x, lo.y + y, lo.z + z);
+				voxels[brickVoxelIndex(x, y, z)] = grid.contains(voxel)
+					? grid.at(voxel.x, voxel.y, voxel.z) : (GLubyte)STD_VOID_INDEX;
+			}
+		}
+	}
+}
+
+int Brickmap::getVoxelRegion(ivec3 voxel_coords, ivec3 &region_lo, ivec3 &region_hi) const {
+	region_lo = region_hi = voxel_coords;
+	if (voxel_coords.x < 0 || voxel_coords.y < 0 || voxel_coords.z < 0
+	 || voxel_coords.x >= size.x || voxel_coords.y >= size.y || voxel_coords.z >= size.z) {
+		return STD_VOID_INDEX;
+	}
+
+	ivec3 cell = ivec3(voxel_coords.x >> BRICK_SHIFT, voxel_coords.y >> BRICK_SHIFT, voxel_coords.z >> BRICK_SHIFT);
+	GLuint entry = cells[cellIndex(cell)];
+	if (entry & BRICK_UNIFORM_BIT) {
+		region_lo = ivec3(cell.x << BRICK_SHIFT, cell.y << BRICK_SHIFT, cell.z << BRICK_SHIFT);
+		region_hi = ivec3(std::min(region_lo.x + BRICK_SIZE, size.x) - 1,
+		                  std::min(region_lo.y + BRICK_SIZE, size.y) - 1,
+		                  std::min(region_lo.z + BRICK_SIZE, size.z) - 1);
+		return entry & 0xFFu;
+	}
+	int i = brickVoxelIndex(voxel_coords.x & (BRICK_SIZE - 1), voxel_coords.y & (BRICK_SIZE - 1), voxel_coords.z & (BRICK_SIZE - 1));
+	return pool[(size_t)entry * BRICK_VOXELS + i];
+}
+
+GLuint Brickmap::allocateBrick() {
+	if (!free_bricks.empty()) {
+		GLuint brick = free_bricks.back();
+		free_bricks.pop_back();
+		return brick;
+	}
+	pool.resize(pool.size() + BRICK_VOXELS);
+	return pool.size() / BRICK_VOXELS - 1;
+}
+
+void Brickmap::updateBrick(ivec3 cell, const VoxelGrid &grid) {
+	GLubyte voxels[BRICK_VOXELS];
+	readBrick(cell, grid, voxels);
+	int value = uniformValue(voxels);
+
+	int i = cellIndex(cell);
+	GLuint &entry = cells[i];
+	if (value >= 0) {
+		if (!(entry & BRICK_UNIFORM_BIT)) {
+			free_bricks.push_back(entry);
+		}
+		entry = BRICK_UNIFORM_BIT | (GLuint)value;
+	} else {
+		if (entry & BRICK_UNIFORM_BIT) {
+			entry = allocateBrick();
+		}
+		memcpy(&pool[(size_t)entry * BRICK_VOXELS], voxels, BRICK_VOXELS);
+		if (cells_buffer != 0) dirty_bricks.push_back(entry);
+	}
+	// Only tracked once uploaded, the first upload sends everything
+	if (cells_buffer != 0) dirty_cells.push_back(i);
+}
+
+void Brickmap::upload() {
+	if (cells_buffer == 0) {
+		glGenBuffers(1, &cells_buffer);
+		glGenBuffers(1, &pool_buffer);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, cells_buffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, cells.size() * sizeof(GLuint), cells.data(), GL_DYNAMIC_DRAW);
+	} else {
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, cells_buffer);
+		for (int i : dirty_cells) {
+			glBufferSubData(GL_SHADER_STORAGE_BUFFER, i * sizeof(GLuint), sizeof(GLuint), &cells[i]);
+		}
+	}
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, pool_buffer);
+	if (pool.size() > uploaded_capacity || uploaded_capacity == 0) {
+		// Room for growth, so that adding bricks rarely reallocates
+		uploaded_capacity = std::max(pool.size() + pool.size() / 2, (size_t)BRICK_VOXELS);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, uploaded_capacity, NULL, GL_DYNAMIC_DRAW);
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, pool.size(), pool.data());
+	} else {
+		for (GLuint brick : dirty_bricks) {
+			glBufferSubData(GL_SHADER_STORAGE_BUFFER, (size_t)brick * BRICK_VOXELS, BRICK_VOXELS,
+			                &pool[(size_t)brick * BRICK_VOXELS]);
+		}
+	}
+	dirty_cells.clear();
+	dirty_bricks.clear();
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BRICKMAP_CELLS_BINDING, cells_buffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BRICKMAP_POOL_BINDING, pool_buffer);
+}
@@ -0,0 +1,82 @@
+#ifndef BRICKMAP_HPP
+#define BRICKMAP_HPP
+
+#include "gl-import.hpp"
+#include "voxel-grid.hpp"
+
+#include <vector>
+
+// Must match shaders/brickmap.glsl
+#define BRICKMAP_CELLS_BINDING 1
+#define BRICKMAP_POOL_BINDING  2
+
+#define BRICK_SHIFT  3
+#define BRICK_SIZE   (1 << BRICK_SHIFT) // Voxels per brick axis
+#define BRICK_VOXELS (BRICK_SIZE * BRICK_SIZE * BRICK_SIZE)
+
+// Cell flag for uniform bricks, which hold their voxel value in the low byte
+// and take no pool storage. Other cells hold the index of their brick in the
+// pool, whose voxels are stored as [z][y][x].
+#define BRICK_UNIFORM_BIT 0x80000000u
+
+
+/**
+ * Two-level voxel storage: a coarse grid of cells, each covering a brick of
+ * BRICK_SIZE^3 voxels, where only non-uniform bricks are stored in a pool.
+ * Voxels beyond the grid size, in bricks on its far sides, are void.
+ */
+class Brickmap {
+
+public:
+	Brickmap() : size{0}, cell_count{0}, cells_buffer{0}, pool_buffer{0}, uploaded_capacity{0} {}
+	Brickmap(const VoxelGrid &grid);
+
+	ivec3 getSize() const { return size; }
+	ivec3 getCellCount() const { return cell_count; }
+	int getBrickCount() const { return (int)(pool.size() / BRICK_VOXELS - free_bricks.size()); }
+
+	/**
+	 * Returns the value of the specified voxel and sets the bounds of its
+	 * brick if uniform, or else of the voxel itself, to the region
+	 * parameters. Voxels outside the grid are void.
+	 */
+	int getVoxelRegion(ivec3 voxel_coords, ivec3 &region_lo, ivec3 &region_hi) const;
+
+	/**
+	 * Replaces the brick of the specified cell with the matching voxels of
+	 * the specified grid. Bricks turning uniform release their pool storage,
+	 * which is reused by the next bricks added.
+	 */
+	void updateBrick(ivec3 cell, const VoxelGrid &grid);
+
+	/**
+	 * Uploads the cells and the pool to shader storage buffers. After the
+	 * first call, only the cells and bricks changed since the last call are
+	 * sent, unless the pool has outgrown its buffer.
+	 */
+	void upload();
+
+private:
+	int cellIndex(ivec3 cell) const {
+		return (cell.z * cell_count.y + cell.y) * cell_count.x + cell.x;
+	}
+	GLuint allocateBrick();
+	void readBrick(ivec3 cell, const VoxelGrid &grid, GLubyte *voxels) const;
+
+	ivec3 size;
+	ivec3 cell_count;
+	std::vector<GLuint>  cells;
+	std::vector<GLubyte> pool;
+	std::vector<GLuint>  free_bricks;
+
+	// Changes not yet uploaded, tracked after the first upload only, so that
+	// brickmaps used on the CPU alone keep none
+	std::vector<int>    dirty_cells;
+	std::vector<GLuint> dirty_bricks;
+
+	GLuint cells_buffer;
+	GLuint pool_buffer;
+	size_t uploaded_capacity; // Pool bytes allocated on the GPU
+};
+
+#endif // BRICKMAP_HPP
@@ -0,0 +1,42 @@
+#include "camera-block.hpp"
+
+#include "GL_utilities.h"
+
+#include <algorithm>
+
+
+//----------------------Implementation-----------------------------------------
+
+// Layout of CameraBlock under std140, matrices row major
+struct CameraBlockData {
+	GLfloat camera_to_world_matrix[16];
+	GLfloat view_pos[3];
+	GLfloat screen_ratio;
+	GLfloat pixel_jitter[2];
+	GLfloat padding[2];
+};
+
+void CameraBlock::upload(const Camera &camera, float screen_ratio, vec2 jitter, int width, int height) {
+	if (buffer == 0) {
+		glGenBuffers(1, &buffer);
+		glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+		glBufferData(GL_UNIFORM_BUFFER, sizeof(CameraBlockData), NULL, GL_DYNAMIC_DRAW);
+		glBindBufferBase(GL_UNIFORM_BUFFER, CAMERA_BLOCK_BINDING, buffer);
+	}
+
+	CameraBlockData data;
+	const mat4 &m = camera.getCameraToWorldMatrix();
+	std::copy(m.m, m.m + 16, data.camera_to_world_matrix);
+	vec3 view_pos = camera.getViewPos();
+	data.view_pos[0] = view_pos.x;
+	data.view_pos[1] = view_pos.y;
+	data.view_pos[2] = view_pos.z;
+	data.screen_ratio = screen_ratio;
+	data.pixel_jitter[0] = 2.0 * jitter.x / width;
+	data.pixel_jitter[1] = 2.0 * jitter.y / height;
+	data.padding[0] = data.padding[1] = 0.0;
+
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(CameraBlockData), &data);
+	printError("upload camera block");
+}
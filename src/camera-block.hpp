@@ -0,0 +1,34 @@
+#ifndef CAMERA_BLOCK_HPP
+#define CAMERA_BLOCK_HPP
+
+#include "camera.hpp"
+#include "gl-import.hpp"
+#include "glsl-math.hpp"
+
+// Uniform buffer binding of CameraBlock, must match shaders/camera.glsl
+#define CAMERA_BLOCK_BINDING 0
+
+
+/**
+ * The uniform block of shaders/camera.glsl, holding the camera and the view
+ * of the frame for every program that traces primary rays. It is written
+ * once per frame, or per sample, right before drawing, so that the camera
+ * itself never touches GL state and programs need not be kept in sync.
+ */
+class CameraBlock {
+
+public:
+	CameraBlock() : buffer{0} {}
+
+	/**
+	 * Writes the view of the specified camera with the specified screen
+	 * ratio and sub-pixel jitter, in pixels of a frame of width by height,
+	 * creating and binding the buffer on first use.
+	 */
+	void upload(const Camera &camera, float screen_ratio, vec2 jitter, int width, int height);
+
+private:
+	GLuint buffer;
+};
+
+#endif // CAMERA_BLOCK_HPP
@@ -1,7 +1,6 @@
 #include "camera.hpp"
 
-#include "shader-utils.hpp"
-#include "voxel-generator.hpp"
+#include "voxel-grid.hpp"
 
 #include "VectorUtils3.h"
 
@@ -9,44 +8,55 @@
 //----------------------Constants----------------------------------------------
 
 #define ROTATE_RATE 0.01
-#define ZOOM_RATE   0.25 * VOXEL_WIDTH * VOXEL_COUNT
+#define ZOOM_RATE   0.25 // Of the largest grid extent, per second
 #define MAX_Y       0.499 * M_PI
 #define MAX_ZOOM    0.01
 #define VIEW_OFFSET 3.0
-#define VIEW_TARGET vec3(0.5 * VOXEL_COUNT * VOXEL_WIDTH)
 
 
 //----------------------Implementation-----------------------------------------
 
-Camera::Camera(float x, float y, GLuint shader)
-	: shader{shader}, x{x}, y{y}, zoom{2.5 * VOXEL_COUNT}, mx_prev{0}, my_prev{0}
+Camera::Camera(float x, float y, ivec3 grid_size)
+	: x{x}, y{y}, mx_prev{0}, my_prev{0}, changed{true}
 {
+	vec3 space_size = toVec3(grid_size) * VOXEL_WIDTH;
+	space_width = std::max(std::max(space_size.x, space_size.y), space_size.z);
+	view_target = 0.5 * space_size;
+	zoom = 2.5 * space_width / VOXEL_WIDTH;
+
 	updateCameraMatrix();
 }
 
 void Camera::updateCameraMatrix() {
 	mat4 rot_y = Ry(x);
 	vec3 sideways = CrossProduct(rot_y * FORWARD, UP);
-	vec3 camera_position = ArbRotate(sideways, y) * rot_y * (zoom * BACK) + VIEW_TARGET;
-	mat4 camera_to_world_matrix = InvertMat4(lookAtv(camera_position, VIEW_TARGET, UP));
-	vec3 view_pos = camera_to_world_matrix * (VIEW_OFFSET * BACK);
-
-	glUseProgram(shader);
-	glUniformMatrix4fv(uniformLoc(shader, "camera_to_world_matrix"), 1, GL_TRUE, camera_to_world_matrix.m);
-	glUniform3fv(uniformLoc(shader, "view_pos"), 1, (GLfloat *)&view_pos);
+	vec3 camera_position = ArbRotate(sideways, y) * rot_y * (zoom * BACK) + view_target;
+	camera_to_world_matrix = InvertMat4(lookAtv(camera_position, view_target, UP));
+	view_pos = camera_to_world_matrix * (VIEW_OFFSET * BACK);
+	changed = true;
 }
 
 void Camera::update(float delta_t) {
 	if (glutKeyIsDown('z')) {
-		zoom -= ZOOM_RATE * delta_t;
+		zoom -= ZOOM_RATE * space_width * delta_t;
 		if (zoom < MAX_ZOOM) zoom = MAX_ZOOM;
 		updateCameraMatrix();
 	} else if (glutKeyIsDown('x')) {
-		zoom += ZOOM_RATE * delta_t;
+		zoom += ZOOM_RATE * space_width * delta_t;
 		updateCameraMatrix();
 	}
 }
 
+bool Camera::isZooming() const {
+	return glutKeyIsDown('z') || glutKeyIsDown('x');
+}
+
+bool Camera::takeChanged() {
+	bool was_changed = changed;
+	changed = false;
+	return was_changed;
+}
+
 void Camera::mouseClicked(int button, int state, int mx, int my)
 {
 	if (state == GLUT_DOWN)
@@ -58,8 +68,16 @@ void Camera::mouseClicked(int button, int state, int mx, int my)
 
 void Camera::mouseDragged(int mx, int my)
 {
-	x -= ROTATE_RATE * (mx - mx_prev);
-	y += ROTATE_RATE * (my_prev - my);
+	orbit(-ROTATE_RATE * (mx - mx_prev), ROTATE_RATE * (my_prev - my));
+
+	mx_prev = mx;
+	my_prev = my;
+}
+
+void Camera::orbit(float dx, float dy)
+{
+	x += dx;
+	y += dy;
 
 	if (y > MAX_Y) {
 		y = MAX_Y;
@@ -69,9 +87,10 @@ void Camera::mouseDragged(int mx, int my)
 	}
 
 	updateCameraMatrix();
+}
 
-	mx_prev = mx;
-	my_prev = my;
-
-	//glutPostRedisplay();
+void Camera::setZoom(float zoom)
+{
+	this->zoom = zoom < MAX_ZOOM ? MAX_ZOOM : zoom;
+	updateCameraMatrix();
 }
@@ -2,24 +2,45 @@
 #define CAMERA_HPP
 
 #include "gl-import.hpp"
+#include "glsl-math.hpp"
+#include "voxel-grid.hpp"
+
+#include "VectorUtils3.h"
 
 
 class Camera {
 
 public:
-	Camera(float x, float y, GLuint shader);
-	Camera() : Camera(0.0, 0.0, 0) {};
+	Camera(float x, float y, ivec3 grid_size);
+	Camera() : Camera(0.0, 0.0, ivec3(DEFAULT_VOXEL_COUNT)) {};
 
 	void updateCameraMatrix();
 	void update(float delta_t);
 	void mouseClicked(int button, int state, int mx, int my);
 	void mouseDragged(int mx, int my);
+	void orbit(float dx, float dy);
+	void setZoom(float zoom);
+
+	// Whether a zoom key is held, requiring calls to update
+	bool isZooming() const;
+
+	/**
+	 * Returns whether the camera moved since the last call.
+	 */
+	bool takeChanged();
+
+	const mat4 &getCameraToWorldMatrix() const { return camera_to_world_matrix; }
+	vec3 getViewPos() const { return view_pos; }
 
 private:
-	GLuint shader;
+	mat4 camera_to_world_matrix;
+	vec3 view_pos;
+	vec3 view_target;  // Center of the grid
+	float space_width; // Largest grid extent
 	float x, y;
 	float zoom;
 	int mx_prev, my_prev;
+	bool changed;
 };
 
 #endif // CAMERA_HPP
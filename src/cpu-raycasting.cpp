@@ -0,0 +1,468 @@
+#include "cpu-raycasting.hpp"
+
+#include "materials.hpp"
+#include "simd-math.hpp"
+
+#include <climits>
+
+
+//----------------------Constants----------------------------------------------
+
+#define VOXEL_WORLD_SKIN vec3(0.0001)
+
+#define HIT_CONDITION_NONREF 0x0001u
+#define HIT_CONDITION_OPAQUE 0x0002u
+
+
+//----------------------Implementation-----------------------------------------
+
+struct RaycastAABBHit {
+	vec3  world_pos;
+	float depth;
+	vec3  normal;
+};
+
+struct AABB { vec3 lo; vec3 hi; };
+
+struct HitCondition {
+	unsigned type;
+	int ref_value;
+};
+
+static vec3 toVoxel(vec3 world_pos) {
+	return world_pos * (1.0 / VOXEL_WIDTH);
+}
+
+static vec3 toWorld(vec3 voxel_pos) {
+	return voxel_pos * VOXEL_WIDTH;
+}
+
+static vec3x8 toVoxel(const vec3x8 &world_pos) {
+	return world_pos * splat<floatx8>(1.0 / VOXEL_WIDTH);
+}
+
+static vec3x8 toWorld(const vec3x8 &voxel_pos) {
+	return voxel_pos * splat<floatx8>(VOXEL_WIDTH);
+}
+
+int getVoxelValue(const VoxelGrid &grid, ivec3 voxel_coords) {
+	if (!grid.contains(voxel_coords)) {
+		// Matches GL_CLAMP_TO_BORDER with a black border
+		return STD_VOID_INDEX;
+	}
+	return grid.at(voxel_coords.x, voxel_coords.y, voxel_coords.z);
+}
+
+// Overloads for each storage the ray marcher traverses, as getVoxelRegion in
+// the shaders
+
+static ivec3 getVoxelCount(const VoxelGrid &grid) {
+	return grid.size;
+}
+
+static ivec3 getVoxelCount(const Brickmap &brickmap) {
+	return brickmap.getSize();
+}
+
+static ivec3 getVoxelCount(const MortonGrid &morton) {
+	return morton.size;
+}
+
+static int getVoxelRegion(const VoxelGrid &grid, ivec3 voxel_coords, ivec3 &region_lo, ivec3 &region_hi) {
+	region_lo = region_hi = voxel_coords;
+	return getVoxelValue(grid, voxel_coords);
+}
+
+static int getVoxelRegion(const Brickmap &brickmap, ivec3 voxel_coords, ivec3 &region_lo, ivec3 &region_hi) {
+	return brickmap.getVoxelRegion(voxel_coords, region_lo, region_hi);
+}
+
+static int getVoxelRegion(const MortonGrid &morton, ivec3 voxel_coords, ivec3 &region_lo, ivec3 &region_hi) {
+	region_lo = region_hi = voxel_coords;
+	if (!morton.contains(voxel_coords)) {
+		return STD_VOID_INDEX;
+	}
+	return morton.at(voxel_coords.x, voxel_coords.y, voxel_coords.z);
+}
+
+template <typename Voxels>
+static int getVoxelValue(const Voxels &voxels, ivec3 voxel_coords) {
+	ivec3 region_lo, region_hi;
+	return getVoxelRegion(voxels, voxel_coords, region_lo, region_hi);
+}
+
+static bool isInBounds(ivec3 a, ivec3 count) {
+	return a.x >= 0 && a.y >= 0 && a.z >= 0
+	    && a.x < count.x && a.y < count.y && a.z < count.z;
+}
+
+/**
+ * Moves one axis of the traversal the number of voxel crossings it has left
+ * before the region exit depth, at most the steps left in the region.
+ */
+static void skipAxis(int &voxel_coord, float &next_depth, int voxel_step, float depth_step,
+                     int steps_left, float region_exit)
+{
+	if (next_depth >= region_exit) {
+		return;
+	}
+	float crossings = std::min(std::max(std::ceil((region_exit - next_depth) / depth_step), 0.0f), (float)steps_left);
+	if (crossings > 0.0) {
+		voxel_coord += (int)crossings * voxel_step;
+		next_depth += crossings * depth_step;
+	}
+}
+
+/**
+ * Skips to the last voxel of the specified region along the ray, as the
+ * region skip in the shaders.
+ */
+static void skipRegion(ivec3 &voxel_coords, vec3 &next_depth, ivec3 voxel_step, vec3 depth_step,
+                       ivec3 region_lo, ivec3 region_hi)
+{
+	ivec3 steps_left = ivec3(voxel_step.x > 0 ? region_hi.x - voxel_coords.x : voxel_coords.x - region_lo.x,
+	                         voxel_step.y > 0 ? region_hi.y - voxel_coords.y : voxel_coords.y - region_lo.y,
+	                         voxel_step.z > 0 ? region_hi.z - voxel_coords.z : voxel_coords.z - region_lo.z);
+	// (Zero steps are masked, as depth_step is infinite along axes the ray is parallel to)
+	vec3 exit_depth = vec3(steps_left.x == 0 ? next_depth.x : next_depth.x + steps_left.x * depth_step.x,
+	                       steps_left.y == 0 ? next_depth.y : next_depth.y + steps_left.y * depth_step.y,
+	                       steps_left.z == 0 ? next_depth.z : next_depth.z + steps_left.z * depth_step.z);
+	float region_exit = std::min(std::min(exit_depth.x, exit_depth.y), exit_depth.z);
+
+	skipAxis(voxel_coords.x, next_depth.x, voxel_step.x, depth_step.x, steps_left.x, region_exit);
+	skipAxis(voxel_coords.y, next_depth.y, voxel_step.y, depth_step.y, steps_left.y, region_exit);
+	skipAxis(voxel_coords.z, next_depth.z, voxel_step.z, depth_step.z, steps_left.z, region_exit);
+}
+
+static bool raycastAABB(const Ray &r, const AABB &aabb, RaycastAABBHit &hit)
+{
+	vec3 dist_lo = mul(aabb.lo - r.o, r.dir_inv);
+	vec3 dist_hi = mul(aabb.hi - r.o, r.dir_inv);
+	vec3 dist_min = min(dist_hi, dist_lo);
+	vec3 dist_max = max(dist_hi, dist_lo);
+	float dist_max_min = std::min(std::min(dist_max.x, dist_max.y), dist_max.z);
+
+	float dist_min_max;
+	vec3 normal = vec3(0.0);
+	if (dist_min.x >= dist_min.y) {
+		if (dist_min.x >= dist_min.z) {
+			normal.x = -r.dir.x;
+			dist_min_max = dist_min.x;
+		}
+		else {
+			normal.z = -r.dir.z;
+			dist_min_max = dist_min.z;
+		}
+	}
+	else if (dist_min.y >= dist_min.z) {
+		normal.y = -r.dir.y;
+		dist_min_max = dist_min.y;
+	}
+	else {
+		normal.z = -r.dir.z;
+		dist_min_max = dist_min.z;
+	}
+
+	if (dist_min_max > dist_max_min) {
+		// No intersection
+		return false;
+	}
+
+	float depth = std::max(dist_min_max, 0.0f);
+	hit = {r.o + depth * r.dir, depth, normalize(normal)};
+	return true;
+}
+
+static bool isHitConditionMet(const HitCondition &c, int hit_value) {
+	if (c.type == HIT_CONDITION_NONREF) {
+		return hit_value != c.ref_value;
+	}
+	else if (c.type == HIT_CONDITION_OPAQUE) {
+		return materials[hit_value].refractivity <= 0.0;
+	}
+	return false;
+}
+
+/**
+ * Returns the hit of the specified ray with a voxel of the specified value,
+ * entered at the specified depth through the face with the specified normal.
+ */
+template <typename Voxels>
+static RaymarchVoxelHit voxelHit(const Voxels &voxels, const Ray &r, int hit_value, int start_value,
+                                 ivec3 voxel_coords, float depth, vec3 normal)
+{
+	int draw_value = hit_value;
+	if (hit_value == STD_VOID_INDEX) {
+		// If exiting into actual void, draw previous material
+		draw_value = getVoxelValue(voxels, ivec3(toVec3(voxel_coords) + normal));
+	}
+	float transparency = 0.0;
+	vec3 world_pos = r.o + depth * r.dir;
+	float refr_index_ratio = materials[start_value].refraction_index / materials[hit_value].refraction_index;
+	return {hit_value, draw_value, voxel_coords, world_pos, depth, normal, refr_index_ratio, transparency};
+}
+
+template <typename Voxels>
+static bool raymarchVoxels(const Voxels &voxels, const Ray &r, RaymarchVoxelHit &hit, int start_value, float max_depth, const HitCondition &hit_condition)
+{
+	ivec3 voxel_coords; // Voxel coordinates
+	ivec3 voxel_step;   // Change in voxel coordinates, per axis, if traversing along said axis
+	vec3  normal;       // Surface normal
+
+	float depth;        // Traversed distance along the ray
+	vec3  next_depth;   // New depth, per axis, if traversing along said axis
+	vec3  depth_step;   // Change in depth, per axis, if traversing along said axis
+	float min_transparency; // Minimum transparency (refractivity) of traversed materials
+
+
+	// Start at intersection with voxel space AABB
+	ivec3 voxel_count = getVoxelCount(voxels);
+	AABB aabb = {toWorld(VOXEL_WORLD_SKIN), toWorld(toVec3(voxel_count)) - VOXEL_WORLD_SKIN};
+	RaycastAABBHit aabb_hit;
+	if (!raycastAABB(r, aabb, aabb_hit)) {
+		// No intersection
+		if (hit_condition.type == HIT_CONDITION_OPAQUE) {
+			// Nothing in the way -- Fully transparent
+			hit = {-1, -1, ivec3(0), vec3(0.0), 0.0, vec3(0.0), 0.0, 1.0};
+		}
+		return false;
+	}
+	depth = aabb_hit.depth;
+	normal = aabb_hit.normal;
+	min_transparency = 1.0;
+
+	// Initialize variables
+	voxel_coords = ivec3(floor(toVoxel(r.o + depth * r.dir)));
+	voxel_step = ivec3(r.dir.x >= 0.0 ? 1 : -1,
+	                   r.dir.y >= 0.0 ? 1 : -1,
+	                   r.dir.z >= 0.0 ? 1 : -1);
+	vec3 init_offset = vec3(r.dir.x >= 0.0 ? 1.0 : 0.0,
+	                        r.dir.y >= 0.0 ? 1.0 : 0.0,
+	                        r.dir.z >= 0.0 ? 1.0 : 0.0);
+	next_depth = mul(toWorld(toVec3(voxel_coords) + init_offset) - r.o, r.dir_inv);
+	depth_step = mul(toWorld(toVec3(voxel_step)), r.dir_inv);
+
+	// Traverse voxel space
+	if (lengthSqrd(r.dir) > 0.0) {
+		while (depth < max_depth && isInBounds(voxel_coords, voxel_count)) {
+
+			// Check voxel hit
+			ivec3 region_lo, region_hi;
+			int hit_value = getVoxelRegion(voxels, voxel_coords, region_lo, region_hi);
+			if (isHitConditionMet(hit_condition, hit_value)) {
+				hit = voxelHit(voxels, r, hit_value, start_value, voxel_coords, depth, normal);
+				return true;
+			}
+
+			min_transparency = std::min(min_transparency, materials[hit_value].refractivity);
+
+			// Skip to the last voxel of the region along the ray, since they
+			// all share the value of this one
+			if (region_lo.x != region_hi.x || region_lo.y != region_hi.y || region_lo.z != region_hi.z) {
+				skipRegion(voxel_coords, next_depth, voxel_step, depth_step, region_lo, region_hi);
+			}
+
+			// Traverse to next voxel
+			if (next_depth.x <= next_depth.y) {
+				if (next_depth.x <= next_depth.z) {
+					depth = next_depth.x;
+					normal = vec3(-voxel_step.x, 0.0, 0.0);
+					voxel_coords.x += voxel_step.x;
+					next_depth.x += depth_step.x;
+				}
+				else {
+					depth = next_depth.z;
+					normal = vec3(0.0, 0.0, -voxel_step.z);
+					voxel_coords.z += voxel_step.z;
+					next_depth.z += depth_step.z;
+				}
+			}
+			else if (next_depth.y <= next_depth.z) {
+				depth = next_depth.y;
+				normal = vec3(0.0, -voxel_step.y, 0.0);
+				voxel_coords.y += voxel_step.y;
+				next_depth.y += depth_step.y;
+			}
+			else {
+				depth = next_depth.z;
+				normal = vec3(0.0, 0.0, -voxel_step.z);
+				voxel_coords.z += voxel_step.z;
+				next_depth.z += depth_step.z;
+			}
+		}
+	}
+
+	if (hit_condition.type == HIT_CONDITION_OPAQUE) {
+		// Didn't hit any opaque materials -- Return min transparency
+		hit = {-1, -1, ivec3(0), vec3(0.0), 0.0, vec3(0.0), 0.0, min_transparency};
+	}
+
+	// No hit
+	return false;
+}
+
+bool raymarchVoxelsDifferent(const VoxelGrid &grid, const Ray &r, RaymarchVoxelHit &hit, int start_value) {
+	return raymarchVoxels(grid, r, hit, start_value, 1e20, {HIT_CONDITION_NONREF, start_value});
+}
+
+bool raymarchVoxelsDifferent(const Brickmap &brickmap, const Ray &r, RaymarchVoxelHit &hit, int start_value) {
+	return raymarchVoxels(brickmap, r, hit, start_value, 1e20, {HIT_CONDITION_NONREF, start_value});
+}
+
+/**
+ * Returns the indices into voxels of the voxels of every lane, which must lie
+ * within a grid of at most INT_MAX voxels.
+ */
+__attribute__((target("avx2")))
+static intx8 voxelIndices(const VoxelGrid &grid, const ivec3x8 &c) {
+	return (c.z * grid.size.y + c.y) * grid.size.x + c.x;
+}
+
+__attribute__((target("avx2")))
+static intx8 voxelIndices(const MortonGrid &morton, const ivec3x8 &c) {
+	const int mask = MORTON_TILE_SIZE - 1;
+	intx8 tile = ((c.z >> MORTON_TILE_SHIFT) * morton.tile_count.y + (c.y >> MORTON_TILE_SHIFT)) * morton.tile_count.x
+	           + (c.x >> MORTON_TILE_SHIFT);
+	return (tile << 3 * MORTON_TILE_SHIFT) | mortonSpread(c.x & mask) | (mortonSpread(c.y & mask) << 1) | (mortonSpread(c.z & mask) << 2);
+}
+
+/**
+ * raymarchVoxels of a packet of rays with the NONREF condition in a grid
+ * without regions,
+ * stepping all rays at once under masks of the rays still traversing. Every
+ * lane makes the same float operations as the scalar traversal, so the hits
+ * are identical.
+ */
+template <typename Voxels>
+__attribute__((target("avx2")))
+static unsigned raymarchVoxelsDifferentAvx2(const Voxels &voxels, const Ray *rays, int count, RaymarchVoxelHit *hits, int start_value)
+{
+	// Unused lanes repeat the last ray, and are masked out of the result
+	vec3x8 o, dir, dir_inv;
+	for (int i = 0; i < RAY_PACKET_SIZE; ++i) {
+		const Ray &r = rays[std::min(i, count - 1)];
+		o.setLane(i, r.o);
+		dir.setLane(i, r.dir);
+		dir_inv.setLane(i, r.dir_inv);
+	}
+	const floatx8 zero = floatx8{};
+	const floatx8 one = splat<floatx8>(1.0);
+
+	// Start at intersection with voxel space AABB, as raycastAABB
+	ivec3 voxel_count = getVoxelCount(voxels);
+	vec3x8 aabb_lo = vec3x8(toWorld(VOXEL_WORLD_SKIN));
+	vec3x8 aabb_hi = vec3x8(toWorld(toVec3(voxel_count)) - VOXEL_WORLD_SKIN);
+	vec3x8 dist_lo = mul(aabb_lo - o, dir_inv);
+	vec3x8 dist_hi = mul(aabb_hi - o, dir_inv);
+	vec3x8 dist_min = min(dist_hi, dist_lo);
+	vec3x8 dist_max = max(dist_hi, dist_lo);
+	floatx8 dist_max_min = min(min(dist_max.x, dist_max.y), dist_max.z);
+
+	intx8 x_ge_y = dist_min.x >= dist_min.y;
+	intx8 enter_x = x_ge_y & (dist_min.x >= dist_min.z);
+	intx8 enter_y = ~x_ge_y & (dist_min.y >= dist_min.z);
+	intx8 enter_z = ~(enter_x | enter_y);
+	floatx8 dist_min_max = select(enter_x, dist_min.x, select(enter_y, dist_min.y, dist_min.z));
+	vec3x8 normal = normalize(vec3x8(select(enter_x, -dir.x, zero),
+	                                 select(enter_y, -dir.y, zero),
+	                                 select(enter_z, -dir.z, zero)));
+
+	intx8 active = (laneIndices<intx8>() < count) & ~(dist_min_max > dist_max_min) & (lengthSqrd(dir) > 0.0f);
+	floatx8 depth = max(dist_min_max, zero);
+
+	// Initialize variables, as raymarchVoxels
+	ivec3x8 voxel_coords = convertLanes<intx8>(floor(toVoxel(o + depth * dir)));
+	ivec3x8 voxel_step = ivec3x8(select(dir.x >= 0.0f, splat<intx8>(1), splat<intx8>(-1)),
+	                             select(dir.y >= 0.0f, splat<intx8>(1), splat<intx8>(-1)),
+	                             select(dir.z >= 0.0f, splat<intx8>(1), splat<intx8>(-1)));
+	vec3x8 init_offset = vec3x8(select(dir.x >= 0.0f, one, zero),
+	                            select(dir.y >= 0.0f, one, zero),
+	                            select(dir.z >= 0.0f, one, zero));
+	vec3x8 next_depth = mul(toWorld(convertLanes<floatx8>(voxel_coords) + init_offset) - o, dir_inv);
+	vec3x8 depth_step = mul(toWorld(convertLanes<floatx8>(voxel_step)), dir_inv);
+	const floatx8 max_depth = splat<floatx8>(1e20);
+	const ivec3x8 count_x8 = ivec3x8(toVec3(voxel_count));
+
+	// Traverse voxel space until every ray has hit or left the grid
+	intx8 hit = intx8{};
+	intx8 hit_values = intx8{};
+	while (true) {
+		active &= (depth < max_depth)
+		        & (voxel_coords.x >= 0) & (voxel_coords.y >= 0) & (voxel_coords.z >= 0)
+		        & (voxel_coords.x < count_x8.x) & (voxel_coords.y < count_x8.y) & (voxel_coords.z < count_x8.z);
+		if (!any(active)) {
+			break;
+		}
+
+		// Check voxel hits
+		intx8 indices = voxelIndices(voxels, voxel_coords);
+		intx8 values;
+		for (int i = 0; i < RAY_PACKET_SIZE; ++i) {
+			values[i] = active[i] ? voxels.voxels[indices[i]] : start_value;
+		}
+		intx8 hit_now = active & (values != start_value);
+		hit_values = select(hit_now, values, hit_values);
+		hit |= hit_now;
+		active &= ~hit_now;
+
+		// Traverse to next voxel
+		intx8 x_le_y = next_depth.x <= next_depth.y;
+		intx8 along_x = active & x_le_y & (next_depth.x <= next_depth.z);
+		intx8 along_y = active & ~x_le_y & (next_depth.y <= next_depth.z);
+		intx8 along_z = active & ~(along_x | along_y);
+		depth = select(along_x, next_depth.x, select(along_y, next_depth.y, select(along_z, next_depth.z, depth)));
+		normal = vec3x8(select(active, select(along_x, -convertLanes<floatx8>(voxel_step).x, zero), normal.x),
+		                select(active, select(along_y, -convertLanes<floatx8>(voxel_step).y, zero), normal.y),
+		                select(active, select(along_z, -convertLanes<floatx8>(voxel_step).z, zero), normal.z));
+		voxel_coords = voxel_coords + ivec3x8(along_x & voxel_step.x, along_y & voxel_step.y, along_z & voxel_step.z);
+		next_depth = vec3x8(select(along_x, next_depth.x + depth_step.x, next_depth.x),
+		                    select(along_y, next_depth.y + depth_step.y, next_depth.y),
+		                    select(along_z, next_depth.z + depth_step.z, next_depth.z));
+	}
+
+	unsigned hit_mask = 0;
+	for (int i = 0; i < count; ++i) {
+		if (!hit[i]) continue;
+		ivec3 coords = ivec3(voxel_coords.x[i], voxel_coords.y[i], voxel_coords.z[i]);
+		hits[i] = voxelHit(voxels, rays[i], hit_values[i], start_value, coords, depth[i], normal.lane(i));
+		hit_mask |= 1u << i;
+	}
+	return hit_mask;
+}
+
+template <typename Voxels>
+static unsigned raymarchPacketDifferent(const Voxels &voxels, const Ray *rays, int count, RaymarchVoxelHit *hits, int start_value) {
+	static const bool has_avx2 = __builtin_cpu_supports("avx2");
+	if (has_avx2 && voxels.voxels.size() <= INT_MAX) {
+		return raymarchVoxelsDifferentAvx2(voxels, rays, count, hits, start_value);
+	}
+	unsigned hit_mask = 0;
+	for (int i = 0; i < count; ++i) {
+		if (raymarchVoxelsDifferent(voxels, rays[i], hits[i], start_value)) hit_mask |= 1u << i;
+	}
+	return hit_mask;
+}
+
+unsigned raymarchVoxelsDifferentPacket(const VoxelGrid &grid, const Ray *rays, int count, RaymarchVoxelHit *hits, int start_value) {
+	return raymarchPacketDifferent(grid, rays, count, hits, start_value);
+}
+
+unsigned raymarchVoxelsDifferentPacket(const MortonGrid &morton, const Ray *rays, int count, RaymarchVoxelHit *hits, int start_value) {
+	return raymarchPacketDifferent(morton, rays, count, hits, start_value);
+}
+
+bool raymarchVoxelsDifferent(const MortonGrid &morton, const Ray &r, RaymarchVoxelHit &hit, int start_value) {
+	return raymarchVoxels(morton, r, hit, start_value, 1e20, {HIT_CONDITION_NONREF, start_value});
+}
+
+bool raymarchVoxelsOpaque(const VoxelGrid &grid, const Ray &r, RaymarchVoxelHit &hit, int start_value, float max_depth) {
+	return raymarchVoxels(grid, r, hit, start_value, max_depth, {HIT_CONDITION_OPAQUE, 0});
+}
+
+bool raymarchVoxelsOpaque(const Brickmap &brickmap, const Ray &r, RaymarchVoxelHit &hit, int start_value, float max_depth) {
+	return raymarchVoxels(brickmap, r, hit, start_value, max_depth, {HIT_CONDITION_OPAQUE, 0});
+}
+
+bool raymarchVoxelsOpaque(const MortonGrid &morton, const Ray &r, RaymarchVoxelHit &hit, int start_value, float max_depth) {
+	return raymarchVoxels(morton, r, hit, start_value, max_depth, {HIT_CONDITION_OPAQUE, 0});
+}
@@ -0,0 +1,74 @@
+#ifndef CPU_RAYCASTING_HPP
+#define CPU_RAYCASTING_HPP
+
+// CPU mirror of shaders/raycasting.glsl
+
+#include "brickmap.hpp"
+#include "gl-import.hpp"
+#include "glsl-math.hpp"
+#include "morton-grid.hpp"
+#include "voxel-grid.hpp"
+
+
+// Rays traversed together by raymarchVoxelsDifferentPacket, the lanes of vec3x8
+#define RAY_PACKET_SIZE 8
+
+// Ray with origin o, direction dir and inverse (1/dir) dir_inv
+struct Ray {
+	vec3 o; vec3 dir; vec3 dir_inv;
+	Ray() {}
+	Ray(vec3 o, vec3 dir) : o{o}, dir{dir}, dir_inv{inverse(dir)} {}
+	Ray(vec3 o, vec3 dir, vec3 dir_inv) : o{o}, dir{dir}, dir_inv{dir_inv} {}
+};
+
+struct RaymarchVoxelHit {
+	int   hit_value;
+	int   draw_value;
+	ivec3 voxel_coords;
+	vec3  world_pos;
+	float depth;
+	vec3  normal;
+	float refr_index_ratio;
+	float transparency;
+};
+
+/**
+ * Returns the value of the specified voxel, or void if outside the grid.
+ */
+int getVoxelValue(const VoxelGrid &grid, ivec3 voxel_coords);
+
+/**
+ * Sets information about the first voxel different form the specified
+ * start value, hit by the specified ray, to the hit parameter.
+ *
+ * Returns true if there was a hit or false otherwise.
+ */
+bool raymarchVoxelsDifferent(const VoxelGrid &grid, const Ray &r, RaymarchVoxelHit &hit, int start_value);
+bool raymarchVoxelsDifferent(const Brickmap &brickmap, const Ray &r, RaymarchVoxelHit &hit, int start_value);
+bool raymarchVoxelsDifferent(const MortonGrid &morton, const Ray &r, RaymarchVoxelHit &hit, int start_value);
+
+/**
+ * Same as raymarchVoxelsDifferent for each of the first count, at most
+ * RAY_PACKET_SIZE, of the specified rays, with the hit of each ray set to the
+ * hit at the same index. The rays are traversed together with AVX2 where the
+ * CPU supports it, which pays off for coherent rays such as the primary rays
+ * of neighbouring pixels, and one at a time otherwise.
+ *
+ * Returns a mask with bit i set if ray i hit.
+ */
+unsigned raymarchVoxelsDifferentPacket(const VoxelGrid &grid, const Ray *rays, int count, RaymarchVoxelHit *hits, int start_value);
+unsigned raymarchVoxelsDifferentPacket(const MortonGrid &morton, const Ray *rays, int count, RaymarchVoxelHit *hits, int start_value);
+
+/**
+ * Sets information about the first opaque voxel, hit by the specified
+ * ray, to the hit parameter.
+ * Stops before the specified maximum depth.
+ *
+ * Returns true if there was a hit or false otherwise.
+ * hit.transparency is set either way.
+ */
+bool raymarchVoxelsOpaque(const VoxelGrid &grid, const Ray &r, RaymarchVoxelHit &hit, int start_value, float max_depth);
+bool raymarchVoxelsOpaque(const Brickmap &brickmap, const Ray &r, RaymarchVoxelHit &hit, int start_value, float max_depth);
+bool raymarchVoxelsOpaque(const MortonGrid &morton, const Ray &r, RaymarchVoxelHit &hit, int start_value, float max_depth);
+
+#endif // CPU_RAYCASTING_HPP
@@ -0,0 +1,195 @@
+#include "cpu-renderer.hpp"
+
+#include "materials.hpp"
+#include "parallel.hpp"
+#include "simd-math.hpp"
+
+
+//----------------------Constants----------------------------------------------
+
+#define AMBIENT_LIGHT vec3(0.05, 0.075, 0.1)
+#define RECURSIVE_RAY_OFFSET 0.001
+
+#define MAX_REFLECTION_DEPTH 4
+#define MAX_REFRACTION_DEPTH 4
+
+#define TILE_SIZE 16
+
+
+//----------------------Implementation-----------------------------------------
+
+static GLubyte toByte(float c) {
+	return (GLubyte)(std::min(std::max(c, 0.0f), 1.0f) * 255.0f + 0.5f);
+}
+
+void CpuRenderer::render(const mat4 &camera_to_world_matrix, vec3 view_pos, Framebuffer &framebuffer) const {
+	int tiles_x = (framebuffer.width + TILE_SIZE - 1) / TILE_SIZE;
+	int tiles_y = (framebuffer.height + TILE_SIZE - 1) / TILE_SIZE;
+	parallelFor(tiles_x * tiles_y, [&](int tile) {
+		renderTile(tile % tiles_x, tile / tiles_x, camera_to_world_matrix, view_pos, framebuffer);
+	});
+}
+
+void CpuRenderer::renderTile(int tile_x, int tile_y, const mat4 &camera_to_world_matrix, vec3 view_pos, Framebuffer &framebuffer) const {
+	float screen_ratio = (float) framebuffer.width / (float) framebuffer.height;
+	int x_end = std::min((tile_x + 1) * TILE_SIZE, framebuffer.width);
+	int y_end = std::min((tile_y + 1) * TILE_SIZE, framebuffer.height);
+	const vec3x8 view_pos_x8 = vec3x8(view_pos);
+
+	for (int y = tile_y * TILE_SIZE; y < y_end; ++y) {
+		// Same as raytracing.vert, interpolated to the pixel center
+		float in_y = 2.0 * (y + 0.5) / framebuffer.height - 1.0;
+
+		// Primary rays of RAY_PACKET_SIZE pixels at a time, the last packet
+		// of a row padded with its last pixel
+		for (int x_begin = tile_x * TILE_SIZE; x_begin < x_end; x_begin += RAY_PACKET_SIZE) {
+			int count = std::min(RAY_PACKET_SIZE, x_end - x_begin);
+			floatx8 in_x;
+			for (int i = 0; i < RAY_PACKET_SIZE; ++i) {
+				int x = x_begin + std::min(i, count - 1);
+				in_x[i] = 2.0 * (x + 0.5) / framebuffer.width - 1.0;
+			}
+			vec3x8 in_pos = vec3x8(splat<floatx8>(screen_ratio) * in_x, splat<floatx8>(in_y), floatx8{});
+			vec3x8 ray_origins = transformPoint(camera_to_world_matrix, in_pos);
+			vec3x8 ray_dirs = normalize(ray_origins - view_pos_x8);
+			vec3x8 ray_dirs_inv = inverse(ray_dirs);
+
+			Ray primary_rays[RAY_PACKET_SIZE];
+			for (int i = 0; i < count; ++i) {
+				primary_rays[i] = Ray(ray_origins.lane(i), ray_dirs.lane(i), ray_dirs_inv.lane(i));
+			}
+
+			// The brickmap skips regions of different size per ray, which
+			// leaves little coherence for packets to exploit
+			RaymarchVoxelHit hits[RAY_PACKET_SIZE];
+			unsigned hit_mask = 0;
+			if (brickmap) {
+				for (int i = 0; i < count; ++i) {
+					if (raymarchDifferent(primary_rays[i], hits[i], 0)) hit_mask |= 1u << i;
+				}
+			} else if (morton) {
+				hit_mask = raymarchVoxelsDifferentPacket(*morton, primary_rays, count, hits, 0);
+			} else {
+				hit_mask = raymarchVoxelsDifferentPacket(*grid, primary_rays, count, hits, 0);
+			}
+
+			for (int i = 0; i < count; ++i) {
+				const Ray &primary_ray = primary_rays[i];
+				vec3 color = AMBIENT_LIGHT;
+				if (hit_mask & (1u << i)) {
+					color += traceHit(primary_ray, hits[i], 0, 0, 1.0, primary_ray.dir);
+				}
+
+				GLubyte *pixel = &framebuffer.pixels[3 * (y * framebuffer.width + x_begin + i)];
+				pixel[0] = toByte(color.x);
+				pixel[1] = toByte(color.y);
+				pixel[2] = toByte(color.z);
+			}
+		}
+	}
+}
+
+/**
+ * Returns the color seen along the specified ray, whose contribution to the
+ * final color is weight. Recursion replaces the iteration tree used in the
+ * shader, since GLSL lacks recursive calls.
+ */
+vec3 CpuRenderer::trace(const Ray &ray, int recursion_depth, int void_value, float weight, vec3 primary_dir) const {
+	RaymarchVoxelHit hit;
+	if (!raymarchDifferent(ray, hit, void_value)) {
+		return vec3(0.0);
+	}
+	return traceHit(ray, hit, recursion_depth, void_value, weight, primary_dir);
+}
+
+/**
+ * Returns the color seen along the specified ray, given its hit.
+ */
+vec3 CpuRenderer::traceHit(const Ray &ray, const RaymarchVoxelHit &hit, int recursion_depth, int void_value, float weight, vec3 primary_dir) const {
+	const MaterialProperties &material = materials[hit.draw_value];
+
+	// Reflection
+	vec3 reflection_color = vec3(0.0);
+	float refl_weight = weight * material.reflectivity;
+	if (refl_weight > 0.0 && refl_weight >= min_ray_weight && recursion_depth < MAX_REFLECTION_DEPTH) {
+		vec3 refl_dir = normalize(reflect(ray.dir, hit.normal));
+		vec3 offset_pos = hit.world_pos + RECURSIVE_RAY_OFFSET * hit.normal;
+		reflection_color = trace(Ray(offset_pos, refl_dir), recursion_depth + 1, void_value, refl_weight, primary_dir);
+	}
+
+	// Refraction, skipped on total internal reflection where refract returns
+	// the zero vector
+	vec3 refraction_color = vec3(0.0);
+	float refr_weight = weight * material.refractivity;
+	if (refr_weight > 0.0 && refr_weight >= min_ray_weight && recursion_depth < MAX_REFRACTION_DEPTH) {
+		vec3 refr_dir = refract(ray.dir, hit.normal, hit.refr_index_ratio);
+		if (lengthSqrd(refr_dir) > 0.0) {
+			refr_dir = normalize(refr_dir);
+			vec3 offset_pos = hit.world_pos - RECURSIVE_RAY_OFFSET * hit.normal;
+			refraction_color = trace(Ray(offset_pos, refr_dir), recursion_depth + 1, hit.hit_value, refr_weight, primary_dir);
+		}
+	}
+
+	return mul(material.color, shade(hit, void_value, primary_dir))
+		+ material.reflectivity * reflection_color
+		+ material.refractivity * refraction_color;
+}
+
+/**
+ * Returns the diffuse and specular light at the specified hit, weighted by
+ * the hit material.
+ */
+vec3 CpuRenderer::shade(const RaymarchVoxelHit &hit, int void_value, vec3 primary_dir) const {
+	const MaterialProperties &material = materials[hit.draw_value];
+	vec3 offset_pos = hit.world_pos + RECURSIVE_RAY_OFFSET * hit.normal;
+
+	vec3 diffuse_light = vec3(0.0);
+	vec3 specular_light = vec3(0.0);
+
+	if (material.diffusivity > 0.0 || material.specularity > 0.0) {
+		for (int light_i = 0; light_i < (int)lights.size(); ++light_i) {
+
+			vec3 light_offset = lights[light_i].pos - hit.world_pos;
+			vec3 to_light = normalize(light_offset);
+
+			// Min transparency towards the light, 0 if blocked
+			float visibility;
+			if (light_volume && light_i < LIGHT_VOLUME_MAX_LIGHTS) {
+				visibility = light_volume->getVisibility(offset_pos, light_i);
+			} else {
+				Ray shadow_ray = Ray(offset_pos, to_light);
+				RaymarchVoxelHit shadow_hit;
+				visibility = raymarchOpaque(shadow_ray, shadow_hit, void_value, std::sqrt(lengthSqrd(light_offset)))
+					? 0.0f : shadow_hit.transparency;
+			}
+			if (visibility > 0.0) {
+
+				// Brightness
+				vec3 brightness = max(vec3(0.0), (lights[light_i].intensity / lengthSqrd(light_offset)) * visibility);
+
+				// Diffuse
+				diffuse_light += max(vec3(0.0), brightness * dot(hit.normal, to_light));
+
+				// Specular
+				float specular = dot(reflect(to_light, hit.normal), primary_dir);
+				if (specular > 0.0)
+					specular = 1.0 * std::pow(specular, 150.0f);
+				specular_light += max(vec3(0.0), brightness * specular);
+			}
+		}
+	}
+
+	return material.diffusivity * diffuse_light + material.specularity * specular_light;
+}
+
+bool CpuRenderer::raymarchDifferent(const Ray &ray, RaymarchVoxelHit &hit, int start_value) const {
+	return brickmap ? raymarchVoxelsDifferent(*brickmap, ray, hit, start_value)
+	     : morton   ? raymarchVoxelsDifferent(*morton, ray, hit, start_value)
+	                : raymarchVoxelsDifferent(*grid, ray, hit, start_value);
+}
+
+bool CpuRenderer::raymarchOpaque(const Ray &ray, RaymarchVoxelHit &hit, int start_value, float max_depth) const {
+	return brickmap ? raymarchVoxelsOpaque(*brickmap, ray, hit, start_value, max_depth)
+	     : morton   ? raymarchVoxelsOpaque(*morton, ray, hit, start_value, max_depth)
+	                : raymarchVoxelsOpaque(*grid, ray, hit, start_value, max_depth);
+}
@@ -0,0 +1,71 @@
+#ifndef CPU_RENDERER_HPP
+#define CPU_RENDERER_HPP
+
+// CPU mirror of shaders/raytracing.frag, rendering tiles on all cores
+
+#include "brickmap.hpp"
+#include "cpu-raycasting.hpp"
+#include "framebuffer.hpp"
+#include "gl-import.hpp"
+#include "light-volume.hpp"
+#include "lights.hpp"
+#include "materials.hpp"
+#include "morton-grid.hpp"
+#include "voxel-grid.hpp"
+
+#include "VectorUtils3.h"
+
+
+class CpuRenderer {
+
+public:
+	/**
+	 * Traverses the brickmap if one is specified, or else the grid.
+	 */
+	CpuRenderer(const VoxelGrid &grid, const Brickmap *brickmap = nullptr)
+		: grid{&grid}, brickmap{brickmap}, morton{nullptr}, light_volume{nullptr}, min_ray_weight{(float)DEFAULT_MIN_RAY_WEIGHT}
+	{
+		lights = placeLights(grid.size);
+	}
+	CpuRenderer() : grid{nullptr}, brickmap{nullptr}, morton{nullptr}, light_volume{nullptr}, min_ray_weight{(float)DEFAULT_MIN_RAY_WEIGHT} {}
+
+	/**
+	 * Traverses the specified copy of the grid in the Morton layout instead
+	 * of the grid, unless there is a brickmap, or the grid again if null.
+	 */
+	void setMortonGrid(const MortonGrid *morton) { this->morton = morton; }
+
+	/**
+	 * Sets the contribution to the final color below which reflection and
+	 * refraction rays are not cast. 0 casts every ray up to the max depth.
+	 */
+	void setMinRayWeight(float weight) { min_ray_weight = weight; }
+
+	/**
+	 * Looks up shadows in the specified baked volume instead of marching
+	 * shadow rays, or marches them again if null.
+	 */
+	void setLightVolume(const LightVolume *volume) { light_volume = volume; }
+
+	void setLights(const std::vector<PointLight> &lights) { this->lights = lights; }
+	const std::vector<PointLight> &getLights() const { return lights; }
+
+	void render(const mat4 &camera_to_world_matrix, vec3 view_pos, Framebuffer &framebuffer) const;
+
+private:
+	void renderTile(int tile_x, int tile_y, const mat4 &camera_to_world_matrix, vec3 view_pos, Framebuffer &framebuffer) const;
+	vec3 trace(const Ray &ray, int recursion_depth, int void_value, float weight, vec3 primary_dir) const;
+	vec3 traceHit(const Ray &ray, const RaymarchVoxelHit &hit, int recursion_depth, int void_value, float weight, vec3 primary_dir) const;
+	vec3 shade(const RaymarchVoxelHit &hit, int void_value, vec3 primary_dir) const;
+	bool raymarchDifferent(const Ray &ray, RaymarchVoxelHit &hit, int start_value) const;
+	bool raymarchOpaque(const Ray &ray, RaymarchVoxelHit &hit, int start_value, float max_depth) const;
+
+	const VoxelGrid *grid;
+	const Brickmap *brickmap;
+	const MortonGrid *morton;
+	const LightVolume *light_volume;
+	float min_ray_weight;
+	std::vector<PointLight> lights;
+};
+
+#endif // CPU_RENDERER_HPP
@@ -0,0 +1,236 @@
+#include "distance-field.hpp"
+
+#include "materials.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+
+
+//----------------------Constants----------------------------------------------
+
+// Distance of lines without any non-void voxel, small enough to never overflow
+#define INFINITE_DISTANCE (1 << 20)
+
+
+//----------------------Implementation-----------------------------------------
+
+/**
+ * Replaces the n values of line, spaced stride apart, with
+ * min over i of max(|u - i|, line[i]) for every u, in linear time.
+ *
+ * References:
+ *	A. Meijster, J. Roerdink, W. Hesselink, "A General Algorithm for Computing
+ *	Distance Transforms in Linear Time", 2000 (chessboard variant)
+ */
+static void transformLine(int *line, int n, size_t stride, std::vector<int> &g,
+                          std::vector<int> &s, std::vector<int> &t)
+{
+	for (int i = 0; i < n; ++i) g[i] = line[i * stride];
+
+	auto f = [&](int u, int i) { return std::max(std::abs(u - i), g[i]); };
+	auto sep = [&](int i, int u) {
+		if (g[i] <= g[u]) return std::max(i + g[u], (i + u) / 2);
+		return std::min(u - g[i], (i + u) / 2);
+	};
+
+	// Lower envelope of the per-voxel cones
+	int q = 0;
+	s[0] = 0;
+	t[0] = 0;
+	for (int u = 1; u < n; ++u) {
+		while (q >= 0 && f(t[q], s[q]) > f(t[q], u)) --q;
+		if (q < 0) {
+			q = 0;
+			s[0] = u;
+		} else {
+			int w = 1 + sep(s[q], u);
+			if (w < n) {
+				++q;
+				s[q] = u;
+				t[q] = w;
+			}
+		}
+	}
+
+	for (int u = n - 1; u >= 0; --u) {
+		line[u * stride] = f(u, s[q]);
+		if (u == t[q]) --q;
+	}
+}
+
+/**
+ * Transforms every line of the grid along one axis, with lines spread over
+ * all threads.
+ */
+static void transformAxis(std::vector<int> &distances, ivec3 size, int axis) {
+	int sizes[3] = {size.x, size.y, size.z};
+	size_t strides[3] = {1, (size_t)size.x, (size_t)size.x * size.y};
+	int n = sizes[axis];
+	int count_a = sizes[(axis + 1) % 3];
+	int count_b = sizes[(axis + 2) % 3];
+	size_t stride_a = strides[(axis + 1) % 3];
+	size_t stride_b = strides[(axis + 2) % 3];
+
+	parallelFor(count_b, [&](int b) {
+		std::vector<int> g(n), s(n), t(n);
+		for (int a = 0; a < count_a; ++a) {
+			transformLine(&distances[a * stride_a + b * stride_b], n, strides[axis], g, s, t);
+		}
+	});
+}
+
+VoxelGrid computeDistanceField(const VoxelGrid &grid) {
+	// L-infinity distance separates into one 1D transform per axis
+	std::vector<int> distances(grid.voxels.size());
+	for (size_t i = 0; i < grid.voxels.size(); ++i) {
+		distances[i] = grid.voxels[i] == STD_VOID_INDEX ? INFINITE_DISTANCE : 0;
+	}
+	for (int axis = 0; axis < 3; ++axis) {
+		transformAxis(distances, grid.size, axis);
+	}
+
+	VoxelGrid clamped(grid.size);
+	for (size_t i = 0; i < distances.size(); ++i) {
+		clamped.voxels[i] = (GLubyte) std::min(distances[i], DISTANCE_FIELD_MAX);
+	}
+	return clamped;
+}
+
+/**
+ * Returns the Chebyshev distance from the specified voxel to the box
+ * [lo, hi], 0 inside it.
+ */
+static int boxDistance(ivec3 voxel, ivec3 lo, ivec3 hi) {
+	int dx = std::max(std::max(lo.x - voxel.x, voxel.x - hi.x), 0);
+	int dy = std::max(std::max(lo.y - voxel.y, voxel.y - hi.y), 0);
+	int dz = std::max(std::max(lo.z - voxel.z, voxel.z - hi.z), 0);
+	return std::max(std::max(dx, dy), dz);
+}
+
+static ivec3 clampToGrid(ivec3 voxel, ivec3 size) {
+	return ivec3(std::min(std::max(voxel.x, 0), size.x - 1),
+	             std::min(std::max(voxel.y, 0), size.y - 1),
+	             std::min(std::max(voxel.z, 0), size.z - 1));
+}
+
+void updateDistanceField(VoxelGrid &distances, const VoxelGrid &grid, ivec3 lo, ivec3 hi,
+                         ivec3 &changed_lo, ivec3 &changed_hi)
+{
+	// Bounds of the non-void voxels in the changed region, the only ones
+	// that may have brought any voxel closer to a non-void one
+	ivec3 solid_lo = hi + ivec3(1);
+	ivec3 solid_hi = lo - ivec3(1);
+	for (int z = lo.z; z <= hi.z; ++z) {
+		for (int y = lo.y; y <= hi.y; ++y) {
+			for (int x = lo.x; x <= hi.x; ++x) {
+				if (grid.at(x, y, z) == STD_VOID_INDEX) continue;
+				solid_lo = ivec3(std::min(solid_lo.x, x), std::min(solid_lo.y, y), std::min(solid_lo.z, z));
+				solid_hi = ivec3(std::max(solid_hi.x, x), std::max(solid_hi.y, y), std::max(solid_hi.z, z));
+			}
+		}
+	}
+	bool added = solid_lo.x <= solid_hi.x;
+
+	// Recompute the region around the change in a window, whose outermost
+	// layer stands in for the voxels beyond it. Those are taken as non-void,
+	// unless the window reaches the grid side, so that distances through
+	// them are never overestimated.
+	ivec3 inner_lo = clampToGrid(lo - ivec3(DISTANCE_FIELD_UPDATE_MARGIN), grid.size);
+	ivec3 inner_hi = clampToGrid(hi + ivec3(DISTANCE_FIELD_UPDATE_MARGIN), grid.size);
+	ivec3 window_lo = clampToGrid(inner_lo - ivec3(1), grid.size);
+	ivec3 window_hi = clampToGrid(inner_hi + ivec3(1), grid.size);
+	ivec3 window_size = window_hi - window_lo + ivec3(1);
+	auto windowIndex = [&](ivec3 voxel) {
+		ivec3 w = voxel - window_lo;
+		return ((size_t)w.z * window_size.y + w.y) * window_size.x + w.x;
+	};
+	auto isInner = [&](ivec3 voxel) {
+		return voxel.x >= inner_lo.x && voxel.y >= inner_lo.y && voxel.z >= inner_lo.z
+		    && voxel.x <= inner_hi.x && voxel.y <= inner_hi.y && voxel.z <= inner_hi.z;
+	};
+
+	std::vector<int> window((size_t)window_size.x * window_size.y * window_size.z);
+	for (int z = window_lo.z; z <= window_hi.z; ++z) {
+		for (int y = window_lo.y; y <= window_hi.y; ++y) {
+			for (int x = window_lo.x; x <= window_hi.x; ++x) {
+				ivec3 voxel = ivec3(x, y, z);
+				bool non_void = grid.at(x, y, z) != STD_VOID_INDEX;
+				window[windowIndex(voxel)] = !isInner(voxel) || non_void ? 0 : INFINITE_DISTANCE;
+			}
+		}
+	}
+	for (int axis = 0; axis < 3; ++axis) {
+		transformAxis(window, window_size, axis);
+	}
+
+	for (int z = inner_lo.z; z <= inner_hi.z; ++z) {
+		for (int y = inner_lo.y; y <= inner_hi.y; ++y) {
+			for (int x = inner_lo.x; x <= inner_hi.x; ++x) {
+				ivec3 voxel = ivec3(x, y, z);
+				int distance = window[windowIndex(voxel)];
+
+				// Exact unless reaching the stand-in layer, beyond which the
+				// old distance still holds, lowered by any voxels added
+				int layer_distance = INFINITE_DISTANCE;
+				if (window_lo.x < inner_lo.x) layer_distance = std::min(layer_distance, x - window_lo.x);
+				if (window_lo.y < inner_lo.y) layer_distance = std::min(layer_distance, y - window_lo.y);
+				if (window_lo.z < inner_lo.z) layer_distance = std::min(layer_distance, z - window_lo.z);
+				if (window_hi.x > inner_hi.x) layer_distance = std::min(layer_distance, window_hi.x - x);
+				if (window_hi.y > inner_hi.y) layer_distance = std::min(layer_distance, window_hi.y - y);
+				if (window_hi.z > inner_hi.z) layer_distance = std::min(layer_distance, window_hi.z - z);
+				if (distance >= layer_distance) {
+					int old_distance = distances.at(x, y, z);
+					if (added) old_distance = std::min(old_distance, boxDistance(voxel, solid_lo, solid_hi));
+					distance = std::max(distance, old_distance);
+				}
+				distances.at(x, y, z) = (GLubyte) std::min(distance, DISTANCE_FIELD_MAX);
+			}
+		}
+	}
+	changed_lo = inner_lo;
+	changed_hi = inner_hi;
+	if (!added) return;
+
+	// Lower the distances beyond the window to the box of the added voxels
+	ivec3 reach_lo = clampToGrid(solid_lo - ivec3(DISTANCE_FIELD_MAX), grid.size);
+	ivec3 reach_hi = clampToGrid(solid_hi + ivec3(DISTANCE_FIELD_MAX), grid.size);
+	std::vector<ivec3> slice_lo(grid.size.z, grid.size);
+	std::vector<ivec3> slice_hi(grid.size.z, ivec3(-1));
+	parallelFor(reach_hi.z - reach_lo.z + 1, [&](int i) {
+		int z = reach_lo.z + i;
+		for (int y = reach_lo.y; y <= reach_hi.y; ++y) {
+			for (int x = reach_lo.x; x <= reach_hi.x; ++x) {
+				ivec3 voxel = ivec3(x, y, z);
+				GLubyte &distance = distances.at(x, y, z);
+				int box_distance = boxDistance(voxel, solid_lo, solid_hi);
+				if (box_distance >= distance || isInner(voxel)) continue;
+				distance = (GLubyte)box_distance;
+				slice_lo[z] = ivec3(std::min(slice_lo[z].x, x), std::min(slice_lo[z].y, y), z);
+				slice_hi[z] = ivec3(std::max(slice_hi[z].x, x), std::max(slice_hi[z].y, y), z);
+			}
+		}
+	});
+	for (int z = reach_lo.z; z <= reach_hi.z; ++z) {
+		if (slice_lo[z].z > slice_hi[z].z) continue;
+		changed_lo = ivec3(std::min(changed_lo.x, slice_lo[z].x), std::min(changed_lo.y, slice_lo[z].y), std::min(changed_lo.z, z));
+		changed_hi = ivec3(std::max(changed_hi.x, slice_hi[z].x), std::max(changed_hi.y, slice_hi[z].y), std::max(changed_hi.z, z));
+	}
+}
+
+GLuint uploadDistanceField(const VoxelGrid &distances) {
+	GLuint distance_tex;
+	glActiveTexture(GL_TEXTURE0 + DISTANCE_FIELD_TEXTURE_UNIT);
+	glGenTextures(1, &distance_tex);
+	glBindTexture(GL_TEXTURE_3D, distance_tex);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage3D(GL_TEXTURE_3D, 0, GL_R8UI, distances.size.x, distances.size.y, distances.size.z,
+				0, GL_RED_INTEGER, GL_UNSIGNED_BYTE, distances.voxels.data());
+	glActiveTexture(GL_TEXTURE0);
+	return distance_tex;
+}
@@ -0,0 +1,44 @@
+#ifndef DISTANCE_FIELD_HPP
+#define DISTANCE_FIELD_HPP
+
+#include "voxel-grid.hpp"
+
+// Largest stored distance, also used when the grid is entirely void
+#define DISTANCE_FIELD_MAX 255
+
+// Texture unit of voxel_distance_tex, voxel_tex stays on unit 0
+#define DISTANCE_FIELD_TEXTURE_UNIT 1
+
+// Voxels around a changed region whose distances are recomputed exactly, up
+// to this distance, by updateDistanceField
+#define DISTANCE_FIELD_UPDATE_MARGIN 16
+
+
+/**
+ * Returns the Chebyshev (L-infinity) distance, in voxels, from every voxel of
+ * the specified grid to the nearest non-void voxel, clamped to
+ * DISTANCE_FIELD_MAX. Non-void voxels get 0, so a void voxel at distance d
+ * is the center of a void cube reaching d - 1 voxels out along every axis.
+ */
+VoxelGrid computeDistanceField(const VoxelGrid &grid);
+
+/**
+ * Updates the distance field of the specified grid after a change to the
+ * voxels in [lo, hi], and sets the box of changed distances to the changed
+ * parameters, empty if changed_lo > changed_hi.
+ *
+ * Only the region within DISTANCE_FIELD_UPDATE_MARGIN voxels is recomputed.
+ * Beyond it, distances are lowered to the nearest non-void voxel added, so
+ * that they may end up smaller than computeDistanceField would give, but
+ * never larger. Smaller distances only shorten the steps over void.
+ */
+void updateDistanceField(VoxelGrid &distances, const VoxelGrid &grid, ivec3 lo, ivec3 hi,
+                         ivec3 &changed_lo, ivec3 &changed_hi);
+
+/**
+ * Uploads the specified distance field as an integer 3D texture bound to
+ * DISTANCE_FIELD_TEXTURE_UNIT, and returns the texture.
+ */
+GLuint uploadDistanceField(const VoxelGrid &distances);
+
+#endif // DISTANCE_FIELD_HPP
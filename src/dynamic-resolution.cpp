@@ -0,0 +1,36 @@
+#include "dynamic-resolution.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+
+//----------------------Implementation-----------------------------------------
+
+void DynamicResolution::update(double frame_ms, int render_width, int render_height) {
+	if (!isEnabled() || width <= 0 || height <= 0) return;
+
+	double frame_ms_per_pixel = frame_ms / ((double)render_width * render_height);
+	ms_per_pixel = ms_per_pixel > 0.0
+		? DYNAMIC_RESOLUTION_SMOOTHING * frame_ms_per_pixel + (1.0 - DYNAMIC_RESOLUTION_SMOOTHING) * ms_per_pixel
+		: frame_ms_per_pixel;
+
+	// Largest scale expected to fit the budget, rounded down to a step
+	double budget_pixels = budget_ms / ms_per_pixel;
+	double fit_scale = std::sqrt(budget_pixels / ((double)width * height));
+	fit_scale = DYNAMIC_RESOLUTION_STEP * std::floor(fit_scale / DYNAMIC_RESOLUTION_STEP);
+	fit_scale = std::min(std::max(fit_scale, DYNAMIC_RESOLUTION_MIN_SCALE), 1.0);
+
+	// Drop at once when over budget, but only rise with room to spare, so
+	// that the scale does not flip between steps
+	if (fit_scale < scale || frame_ms < DYNAMIC_RESOLUTION_HEADROOM * budget_ms) {
+		scale = fit_scale;
+	}
+}
+
+int DynamicResolution::getRenderWidth() const {
+	return std::max(1, (int)std::lround(scale * width));
+}
+
+int DynamicResolution::getRenderHeight() const {
+	return std::max(1, (int)std::lround(scale * height));
+}
@@ -0,0 +1,53 @@
+#ifndef DYNAMIC_RESOLUTION_HPP
+#define DYNAMIC_RESOLUTION_HPP
+
+// Frame time budget in a window unless chosen with --frame-budget, in ms
+#define DEFAULT_FRAME_BUDGET_MS 16.0
+
+#define DYNAMIC_RESOLUTION_MIN_SCALE 0.25
+#define DYNAMIC_RESOLUTION_STEP      0.0625 // Scales are multiples of this
+
+// Weight of the latest frame in the smoothed cost per pixel
+#define DYNAMIC_RESOLUTION_SMOOTHING 0.5
+
+// Scale is only raised once frames take less than this part of the budget
+#define DYNAMIC_RESOLUTION_HEADROOM 0.8
+
+
+/**
+ * Picks the resolution to ray trace at, as a scale of the window size per
+ * axis, to keep frames within a time budget. The cost per pixel is learned
+ * from the measured frame times, so a change of window size, scene or view
+ * is followed within a few frames.
+ */
+class DynamicResolution {
+
+public:
+	DynamicResolution()
+		: budget_ms{0.0}, scale{1.0}, ms_per_pixel{0.0}, width{0}, height{0} {}
+
+	// 0 disables scaling
+	void setBudget(double ms) { budget_ms = ms; scale = 1.0; }
+	bool isEnabled() const { return budget_ms > 0.0; }
+
+	void resize(int width, int height) { this->width = width; this->height = height; }
+
+	/**
+	 * Adapts the scale to the time of a frame traced at the specified size.
+	 */
+	void update(double frame_ms, int render_width, int render_height);
+
+	float getScale() const { return scale; }
+
+	// Size to trace at, at least 1x1
+	int getRenderWidth() const;
+	int getRenderHeight() const;
+
+private:
+	double budget_ms;
+	float scale;
+	double ms_per_pixel; // Smoothed, 0 until measured
+	int width, height;   // Window size
+};
+
+#endif // DYNAMIC_RESOLUTION_HPP
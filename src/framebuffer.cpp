@@ -0,0 +1,40 @@
+#include "framebuffer.hpp"
+
+#include <cstdio>
+#include <vector>
+
+
+void Framebuffer::readPixels() {
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+}
+
+bool Framebuffer::saveTGA(const char *filename) const {
+	// Written here rather than with SaveDataToTGA, which expects rows padded
+	// to a power-of-2 stride but swaps only the first width * height pixels
+	// to BGR, regardless of the padding.
+	FILE *file = fopen(filename, "wb");
+	if (!file) return false;
+
+	// Uncompressed true-color, 24 bits per pixel, rows stored bottom-up
+	GLubyte header[18] = {0, 0, 2};
+	header[12] = width & 0xFF;
+	header[13] = (width >> 8) & 0xFF;
+	header[14] = height & 0xFF;
+	header[15] = (height >> 8) & 0xFF;
+	header[16] = 24;
+	bool ok = fwrite(header, sizeof header, 1, file) == 1;
+
+	std::vector<GLubyte> row(3 * width);
+	for (int y = 0; ok && y < height; ++y) {
+		const GLubyte *src = &pixels[3 * width * y];
+		for (int x = 0; x < width; ++x) {
+			row[3 * x]     = src[3 * x + 2];
+			row[3 * x + 1] = src[3 * x + 1];
+			row[3 * x + 2] = src[3 * x];
+		}
+		ok = fwrite(row.data(), 1, row.size(), file) == row.size();
+	}
+
+	return fclose(file) == 0 && ok;
+}
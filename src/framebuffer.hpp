@@ -0,0 +1,36 @@
+#ifndef FRAMEBUFFER_HPP
+#define FRAMEBUFFER_HPP
+
+#include "gl-import.hpp"
+
+#include <vector>
+
+
+// RGB image with rows stored bottom-up, like glReadPixels
+struct Framebuffer {
+	int width, height;
+	std::vector<GLubyte> pixels;
+
+	Framebuffer(int width, int height) : width{width}, height{height}, pixels(3 * width * height) {}
+	Framebuffer() : Framebuffer(0, 0) {}
+
+	void resize(int w, int h) {
+		width = w;
+		height = h;
+		pixels.resize(3 * width * height);
+	}
+
+	/**
+	 * Reads the currently bound GL read framebuffer into this image.
+	 */
+	void readPixels();
+
+	/**
+	 * Writes this image to the specified TGA file.
+	 *
+	 * Returns true on success or false otherwise.
+	 */
+	bool saveTGA(const char *filename) const;
+};
+
+#endif // FRAMEBUFFER_HPP
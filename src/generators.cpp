@@ -0,0 +1,384 @@
+#include "generators.hpp"
+
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+
+// The row loops are written to vectorize, with the cost model set for this
+// file in the makefile
+
+
+//----------------------Constants----------------------------------------------
+
+// Sizes in the test scene, as ratios of the grid size per axis
+#define TEST_CENTER_GLASS 0.125 // Glass cube in the center
+#define TEST_WALL_HOLE    0.25  // Holes through the middle of every wall
+#define TEST_WALL_GLASS   0.875 // Glass panes around the holes
+
+// Smallest lattice period of noise octaves, in voxels, below which octaves
+// only add aliasing
+#define MIN_NOISE_PERIOD 2.0
+
+
+//----------------------Test scene---------------------------------------------
+
+// Ratios are per axis of the grid size
+static bool isWithinRatio(int x, int count, float r) {
+	return x >= int(0.5 * count - 0.5 * r * count)
+	    && x <= int(0.5 * count + 0.5 * r * count - 0.5);
+}
+
+/**
+ * The original test scene: a room of solid walls with glass panes and
+ * holes through the middle of every wall, open at the top, around a cube of
+ * semi-solid glass.
+ */
+class TestSceneGenerator : public Generator {
+
+public:
+	void fillSlab(int z, ivec3 size, GLubyte *slab) const override;
+};
+
+void TestSceneGenerator::fillSlab(int z, ivec3 size, GLubyte *slab) const {
+	// Whether every x is within each ratio or on a wall, as masks to
+	// combine with those of y and z
+	std::vector<GLubyte> center_x(size.x), hole_x(size.x), glass_x(size.x), wall_x(size.x);
+	for (int x = 0; x < size.x; ++x) {
+		center_x[x] = isWithinRatio(x, size.x, TEST_CENTER_GLASS);
+		hole_x[x] = isWithinRatio(x, size.x, TEST_WALL_HOLE);
+		glass_x[x] = isWithinRatio(x, size.x, TEST_WALL_GLASS);
+		wall_x[x] = x == 0 || x == size.x - 1;
+	}
+	GLubyte center_z = isWithinRatio(z, size.z, TEST_CENTER_GLASS);
+	GLubyte hole_z = isWithinRatio(z, size.z, TEST_WALL_HOLE);
+	GLubyte glass_z = isWithinRatio(z, size.z, TEST_WALL_GLASS);
+	GLubyte wall_z = z == 0 || z == size.z - 1;
+	GLubyte pane = (GLubyte)(z == size.z - 1 ? Material::VOID : Material::GLASS);
+
+	for (int y = 0; y < size.y; ++y) {
+		GLubyte hole_y = isWithinRatio(y, size.y, TEST_WALL_HOLE);
+		GLubyte glass_y = isWithinRatio(y, size.y, TEST_WALL_GLASS);
+		GLubyte center_yz = center_z & isWithinRatio(y, size.y, TEST_CENTER_GLASS);
+		GLubyte wall_yz = wall_z | (y == 0) | (y == size.y - 1);
+		GLubyte hole_yz = hole_y & hole_z;
+		GLubyte glass_yz = glass_y & glass_z;
+		GLubyte hole_y_or_z = hole_y | hole_z;
+		GLubyte glass_y_or_z = glass_y | glass_z;
+
+		// Bitwise rather than logical operators, to combine the masks
+		// without branching
+		GLubyte *row = slab + (size_t)y * size.x;
+		for (int x = 0; x < size.x; ++x) {
+			GLubyte hole = hole_yz | (hole_x[x] & hole_y_or_z);
+			GLubyte glass = glass_yz | (glass_x[x] & glass_y_or_z);
+			GLubyte wall = glass ? pane : (GLubyte)Material::SOLID;
+			GLubyte empty = hole | ((wall_yz | wall_x[x]) ^ 1);
+			row[x] = center_yz & center_x[x] ? (GLubyte)Material::SEMI_SOLID
+			       : empty ? (GLubyte)Material::VOID
+			       : wall;
+		}
+	}
+}
+
+
+//----------------------Primitives---------------------------------------------
+
+void BoxGenerator::fillSlab(int z, ivec3 size, GLubyte *slab) const {
+	if (z < lo.z || z > hi.z) return;
+	int x0 = std::max(lo.x, 0), x1 = std::min(hi.x, size.x - 1);
+	int y0 = std::max(lo.y, 0), y1 = std::min(hi.y, size.y - 1);
+	if (x0 > x1) return;
+	for (int y = y0; y <= y1; ++y) {
+		GLubyte *row = slab + (size_t)y * size.x;
+		std::fill(row + x0, row + x1 + 1, (GLubyte)material);
+	}
+}
+
+void SphereGenerator::fillSlab(int z, ivec3 size, GLubyte *slab) const {
+	float dz = z + 0.5 - center.z;
+	for (int y = 0; y < size.y; ++y) {
+		float dy = y + 0.5 - center.y;
+		float remaining = radius * radius - dy * dy - dz * dz;
+		if (remaining < 0.0) continue;
+
+		// Span of voxel centers within the sphere on this row
+		float half = std::sqrt(remaining);
+		int x0 = std::max(0, (int)std::ceil(center.x - half - 0.5));
+		int x1 = std::min(size.x - 1, (int)std::floor(center.x + half - 0.5));
+		if (x0 > x1) continue;
+		GLubyte *row = slab + (size_t)y * size.x;
+		std::fill(row + x0, row + x1 + 1, (GLubyte)material);
+	}
+}
+
+void CsgGenerator::fillSlab(int z, ivec3 size, GLubyte *slab) const {
+	size_t count = (size_t)size.x * size.y;
+	std::vector<GLubyte> other(count, (GLubyte)Material::VOID);
+	a->fillSlab(z, size, slab);
+	b->fillSlab(z, size, other.data());
+
+	const GLubyte *b_slab = other.data();
+	const GLubyte none = (GLubyte)Material::VOID;
+	switch (operation) {
+	case CsgOperation::UNION:
+		for (size_t i = 0; i < count; ++i) slab[i] = b_slab[i] != none ? b_slab[i] : slab[i];
+		break;
+	case CsgOperation::INTERSECTION:
+		for (size_t i = 0; i < count; ++i) slab[i] = b_slab[i] != none ? slab[i] : none;
+		break;
+	case CsgOperation::DIFFERENCE:
+		for (size_t i = 0; i < count; ++i) slab[i] = b_slab[i] != none ? none : slab[i];
+		break;
+	}
+}
+
+
+//----------------------Noise--------------------------------------------------
+
+/**
+ * Returns a random value in [-1, 1) for the specified lattice point.
+ */
+static float latticeValue(int x, int y, int z, unsigned seed) {
+	uint32_t h = (uint32_t)x * 0x8da6b343u ^ (uint32_t)y * 0xd8163841u
+	           ^ (uint32_t)z * 0xcb1ab31fu ^ seed * 0x9e3779b9u;
+	h ^= h >> 15;
+	h *= 0x2c1b3c6du;
+	h ^= h >> 12;
+	h *= 0x297a2d39u;
+	h ^= h >> 15;
+	return (float)(h >> 8) * (2.0f / 16777216.0f) - 1.0f;
+}
+
+static float smoothstep(float t) {
+	return t * t * (3.0f - 2.0f * t);
+}
+
+/**
+ * Adds amplitude times value noise of the specified lattice period to
+ * out[x] for x in [0, count), sampled at (x, y, z). The lattice is
+ * interpolated over y and z once per cell along the row, leaving a single
+ * interpolation over x per voxel.
+ */
+static void addNoiseOctave(float y, float z, int count, float period, float amplitude,
+                           unsigned seed, float *out)
+{
+	float frequency = 1.0f / period;
+	float fy = y * frequency, fz = z * frequency;
+	int iy = (int)std::floor(fy), iz = (int)std::floor(fz);
+	float ty = smoothstep(fy - iy), tz = smoothstep(fz - iz);
+
+	// Noise where the row crosses the lattice plane at x = i * period
+	auto crossing = [&](int i) {
+		float v00 = latticeValue(i, iy, iz, seed);
+		float v10 = latticeValue(i, iy + 1, iz, seed);
+		float v01 = latticeValue(i, iy, iz + 1, seed);
+		float v11 = latticeValue(i, iy + 1, iz + 1, seed);
+		float v0 = v00 + (v10 - v00) * ty;
+		float v1 = v01 + (v11 - v01) * ty;
+		return v0 + (v1 - v0) * tz;
+	};
+
+	float start = crossing(0);
+	int x = 0;
+	for (int i = 0; x < count; ++i) {
+		float end = crossing(i + 1);
+		float a = amplitude * start;
+		float d = amplitude * (end - start);
+		int cell_end = std::min(count, (int)std::ceil((i + 1) * period));
+		for (; x < cell_end; ++x) {
+			out[x] += a + d * smoothstep(x * frequency - i);
+		}
+		start = end;
+	}
+}
+
+void FractalNoise::sampleRow(float y, float z, int count, float *out) const {
+	float total = 0.0;
+	for (int octave = 0; octave < octaves; ++octave) {
+		total += std::ldexp(1.0f, -octave);
+	}
+	std::fill(out, out + count, 0.0f);
+	for (int octave = 0; octave < octaves; ++octave) {
+		addNoiseOctave(y, z, count, std::ldexp(period, -octave), std::ldexp(1.0f, -octave) / total,
+		               seed + octave, out);
+	}
+}
+
+/**
+ * Fills every column of the slab from the bottom up to the specified
+ * height, in voxels, at each x.
+ */
+static void fillColumns(const float *heights, ivec3 size, Material material, GLubyte *slab) {
+	std::vector<int> tops(size.x);
+	int max_top = 0;
+	for (int x = 0; x < size.x; ++x) {
+		tops[x] = std::min(std::max((int)std::ceil(heights[x]), 0), size.y);
+		max_top = std::max(max_top, tops[x]);
+	}
+	const GLubyte value = (GLubyte)material;
+	for (int y = 0; y < max_top; ++y) {
+		GLubyte *row = slab + (size_t)y * size.x;
+		for (int x = 0; x < size.x; ++x) {
+			row[x] = y < tops[x] ? value : (GLubyte)Material::VOID;
+		}
+	}
+}
+
+void TerrainGenerator::fillSlab(int z, ivec3 size, GLubyte *slab) const {
+	std::vector<float> heights(size.x);
+	noise.sampleRow(0.0, z, size.x, heights.data());
+	for (int x = 0; x < size.x; ++x) {
+		heights[x] = base_height + amplitude * heights[x];
+	}
+	fillColumns(heights.data(), size, material, slab);
+}
+
+void CaveGenerator::fillSlab(int z, ivec3 size, GLubyte *slab) const {
+	std::vector<float> a(size.x), b(size.x);
+	for (int y = 0; y < size.y; ++y) {
+		noise_a.sampleRow(y, z, size.x, a.data());
+		noise_b.sampleRow(y, z, size.x, b.data());
+		GLubyte *row = slab + (size_t)y * size.x;
+		for (int x = 0; x < size.x; ++x) {
+			bool tunnel = std::max(std::fabs(a[x]), std::fabs(b[x])) < radius;
+			row[x] = tunnel ? (GLubyte)Material::SOLID : (GLubyte)Material::VOID;
+		}
+	}
+}
+
+
+//----------------------Height maps--------------------------------------------
+
+void HeightmapGenerator::fillSlab(int z, ivec3 size, GLubyte *slab) const {
+	// Pixel centers are spread over the voxel centers of each axis
+	float v = std::min(std::max((z + 0.5f) * height / size.z - 0.5f, 0.0f), height - 1.0f);
+	int v0 = (int)v, v1 = std::min(v0 + 1, height - 1);
+	float tv = v - v0;
+	const float *row0 = &heights[(size_t)v0 * width];
+	const float *row1 = &heights[(size_t)v1 * width];
+
+	std::vector<float> column_heights(size.x);
+	for (int x = 0; x < size.x; ++x) {
+		float u = std::min(std::max((x + 0.5f) * width / size.x - 0.5f, 0.0f), width - 1.0f);
+		int u0 = (int)u, u1 = std::min(u0 + 1, width - 1);
+		float tu = u - u0;
+		float h0 = row0[u0] + (row0[u1] - row0[u0]) * tu;
+		float h1 = row1[u0] + (row1[u1] - row1[u0]) * tu;
+		column_heights[x] = (h0 + (h1 - h0) * tv) * size.y;
+	}
+	fillColumns(column_heights.data(), size, material, slab);
+}
+
+/**
+ * Reads the next number of a PGM header, skipping whitespace and comments.
+ */
+static bool readPgmNumber(FILE *file, int &value) {
+	int c = fgetc(file);
+	while (c == '#' || isspace(c)) {
+		if (c == '#') {
+			while (c != '\n' && c != EOF) c = fgetc(file);
+		}
+		c = fgetc(file);
+	}
+	if (!isdigit(c)) return false;
+	value = 0;
+	for (; isdigit(c); c = fgetc(file)) {
+		value = 10 * value + (c - '0');
+	}
+	// The single whitespace after the last number is part of the header
+	return isspace(c);
+}
+
+std::unique_ptr<Generator> loadHeightmap(const char *path, Material material) {
+	FILE *file = fopen(path, "rb");
+	if (file == NULL) {
+		fprintf(stderr, "Unable to open file '%s'\n", path);
+		return nullptr;
+	}
+
+	char magic[2];
+	int width, height, max_value;
+	if (fread(magic, 1, 2, file) != 2 || magic[0] != 'P' || magic[1] != '5'
+	 || !readPgmNumber(file, width) || !readPgmNumber(file, height) || !readPgmNumber(file, max_value)
+	 || width < 1 || height < 1 || max_value < 1 || max_value > 65535) {
+		fprintf(stderr, "Not a binary PGM height map: '%s'\n", path);
+		fclose(file);
+		return nullptr;
+	}
+
+	// Samples are big-endian words above 8 bits
+	size_t count = (size_t)width * height;
+	int sample_size = max_value > 255 ? 2 : 1;
+	std::vector<unsigned char> data(count * sample_size);
+	bool complete = fread(data.data(), sample_size, count, file) == count;
+	fclose(file);
+	if (!complete) {
+		fprintf(stderr, "Truncated height map: '%s'\n", path);
+		return nullptr;
+	}
+
+	std::vector<float> heights(count);
+	for (size_t i = 0; i < count; ++i) {
+		int sample = sample_size == 2 ? data[2 * i] << 8 | data[2 * i + 1] : data[i];
+		heights[i] = std::min(sample, max_value) / (float)max_value;
+	}
+	return std::unique_ptr<Generator>(new HeightmapGenerator(width, height, std::move(heights), material));
+}
+
+
+//----------------------Scenes-------------------------------------------------
+
+VoxelGrid generateVoxels(const Generator &generator, ivec3 size) {
+	VoxelGrid grid(size);
+	parallelFor(size.z, [&](int z) {
+		generator.fillSlab(z, size, &grid.voxels[grid.index(0, 0, z)]);
+	});
+	return grid;
+}
+
+/**
+ * Returns noise with octaves from the specified period down to
+ * MIN_NOISE_PERIOD, at most max_octaves of them.
+ */
+static FractalNoise noiseFor(float period, int max_octaves, unsigned seed) {
+	int octaves = 1;
+	while (octaves < max_octaves && std::ldexp(period, -octaves) >= MIN_NOISE_PERIOD) ++octaves;
+	return FractalNoise{std::max(period, 1.0f), octaves, seed};
+}
+
+std::unique_ptr<Generator> createGenerator(GeneratedScene scene, ivec3 size, unsigned seed) {
+	using Pointer = std::unique_ptr<Generator>;
+	vec3 center = 0.5 * toVec3(size);
+	float extent = std::min(std::min(size.x, size.y), size.z);
+	float width = std::max(size.x, size.z);
+
+	switch (scene) {
+	case GeneratedScene::SHAPES: {
+		// A cube hollowed out by a larger sphere around a glass ball, on a floor
+		vec3 corner = vec3(0.3 * extent, 0.3 * extent, 0.3 * extent);
+		ivec3 lo = ivec3((int)(center.x - corner.x), (int)(center.y - corner.y), (int)(center.z - corner.z));
+		ivec3 hi = ivec3((int)(center.x + corner.x), (int)(center.y + corner.y), (int)(center.z + corner.z));
+		Pointer frame(new CsgGenerator(CsgOperation::DIFFERENCE,
+			Pointer(new BoxGenerator(lo, hi, Material::SOLID)),
+			Pointer(new SphereGenerator(center, 0.4 * extent, Material::SOLID))));
+		Pointer ball(new SphereGenerator(center, 0.25 * extent, Material::GLASS));
+		Pointer floor(new BoxGenerator(ivec3(0), ivec3(size.x - 1, size.y / 16, size.z - 1), Material::SEMI_SOLID));
+		return Pointer(new CsgGenerator(CsgOperation::UNION, std::move(floor),
+			Pointer(new CsgGenerator(CsgOperation::UNION, std::move(frame), std::move(ball)))));
+	}
+	case GeneratedScene::TERRAIN:
+		return Pointer(new TerrainGenerator(0.35 * size.y, 0.3 * size.y, noiseFor(0.5 * width, 6, seed), Material::SOLID));
+	case GeneratedScene::CAVES: {
+		Pointer terrain(new TerrainGenerator(0.5 * size.y, 0.25 * size.y, noiseFor(0.5 * width, 6, seed), Material::SOLID));
+		Pointer caves(new CaveGenerator(0.15, noiseFor(0.25 * width, 2, seed + 101), noiseFor(0.25 * width, 2, seed + 211)));
+		return Pointer(new CsgGenerator(CsgOperation::DIFFERENCE, std::move(terrain), std::move(caves)));
+	}
+	case GeneratedScene::TEST:
+	default:
+		return Pointer(new TestSceneGenerator());
+	}
+}
@@ -0,0 +1,184 @@
+#ifndef GENERATORS_HPP
+#define GENERATORS_HPP
+
+#include "gl-import.hpp"
+#include "glsl-math.hpp"
+#include "materials.hpp"
+#include "voxel-grid.hpp"
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+// Generated scenes to choose from with --scene
+enum class GeneratedScene {
+	TEST,    // Glass cube in a walled room with holes, the default
+	SHAPES,  // Primitives combined by CSG on a floor
+	TERRAIN, // Fractal noise hills
+	CAVES    // Fractal noise hills with tunnels carved through them
+};
+
+
+/**
+ * Procedural voxels, produced one slab of constant z at a time so that a
+ * grid can be filled by many threads at once. Slabs are stored as [y][x],
+ * as in VoxelGrid, and generators work along whole rows of x at a time to
+ * keep their inner loops free of branches and calls.
+ */
+class Generator {
+
+public:
+	virtual ~Generator() {}
+
+	/**
+	 * Sets the voxels of the slab at the specified z of a grid of the
+	 * specified size. The slab is void on entry, voxels outside of what is
+	 * generated are to be left void.
+	 */
+	virtual void fillSlab(int z, ivec3 size, GLubyte *slab) const = 0;
+};
+
+/**
+ * Returns a grid of the specified size filled by the specified generator,
+ * spread over all hardware threads by slab.
+ */
+VoxelGrid generateVoxels(const Generator &generator, ivec3 size);
+
+/**
+ * Returns the generator of the specified scene for a grid of the specified
+ * size. Scenes built from noise vary with the seed.
+ */
+std::unique_ptr<Generator> createGenerator(GeneratedScene scene, ivec3 size, unsigned seed);
+
+/**
+ * Loads the specified binary PGM file, 8 or 16 bits per pixel, as terrain
+ * of the specified material, stretched over the x and z axes of the grid
+ * with white at its top. Returns null if the file could not be loaded.
+ */
+std::unique_ptr<Generator> loadHeightmap(const char *path, Material material);
+
+
+//----------------------Primitives---------------------------------------------
+
+/**
+ * Voxels within [lo, hi].
+ */
+class BoxGenerator : public Generator {
+
+public:
+	BoxGenerator(ivec3 lo, ivec3 hi, Material material) : lo{lo}, hi{hi}, material{material} {}
+	void fillSlab(int z, ivec3 size, GLubyte *slab) const override;
+
+private:
+	ivec3 lo, hi;
+	Material material;
+};
+
+/**
+ * Voxels whose center lies within radius of center, in voxels.
+ */
+class SphereGenerator : public Generator {
+
+public:
+	SphereGenerator(vec3 center, float radius, Material material)
+		: center{center}, radius{radius}, material{material} {}
+	void fillSlab(int z, ivec3 size, GLubyte *slab) const override;
+
+private:
+	vec3 center;
+	float radius;
+	Material material;
+};
+
+enum class CsgOperation {
+	UNION,        // Voxels of either, those of b where both are set
+	INTERSECTION, // Voxels of a where b is set as well
+	DIFFERENCE    // Voxels of a where b is void
+};
+
+/**
+ * Combination of two generators.
+ */
+class CsgGenerator : public Generator {
+
+public:
+	CsgGenerator(CsgOperation operation, std::unique_ptr<Generator> a, std::unique_ptr<Generator> b)
+		: operation{operation}, a{std::move(a)}, b{std::move(b)} {}
+	void fillSlab(int z, ivec3 size, GLubyte *slab) const override;
+
+private:
+	CsgOperation operation;
+	std::unique_ptr<Generator> a, b;
+};
+
+
+//----------------------Noise--------------------------------------------------
+
+/**
+ * Fractal value noise: octaves of smoothly interpolated random values on
+ * lattices of halving period, each at half the amplitude of the last, in
+ * [-1, 1] overall.
+ */
+struct FractalNoise {
+	float period;  // Lattice spacing of the first octave, in voxels
+	int octaves;
+	unsigned seed;
+
+	/**
+	 * Sets out[x] to the noise at (x, y, z) for x in [0, count).
+	 */
+	void sampleRow(float y, float z, int count, float *out) const;
+};
+
+/**
+ * Ground up to a height field of base_height + amplitude * noise at every
+ * x and z, in voxels.
+ */
+class TerrainGenerator : public Generator {
+
+public:
+	TerrainGenerator(float base_height, float amplitude, FractalNoise noise, Material material)
+		: base_height{base_height}, amplitude{amplitude}, noise{noise}, material{material} {}
+	void fillSlab(int z, ivec3 size, GLubyte *slab) const override;
+
+private:
+	float base_height;
+	float amplitude;
+	FractalNoise noise;
+	Material material;
+};
+
+/**
+ * Winding tunnels where two noise fields both lie within radius of 0, to
+ * be carved out of other generators by CSG difference.
+ */
+class CaveGenerator : public Generator {
+
+public:
+	CaveGenerator(float radius, FractalNoise noise_a, FractalNoise noise_b)
+		: radius{radius}, noise_a{noise_a}, noise_b{noise_b} {}
+	void fillSlab(int z, ivec3 size, GLubyte *slab) const override;
+
+private:
+	float radius;
+	FractalNoise noise_a, noise_b;
+};
+
+/**
+ * Ground up to a height map stretched over the x and z axes of the grid,
+ * bilinearly interpolated, with heights in [0, 1] of the grid height.
+ */
+class HeightmapGenerator : public Generator {
+
+public:
+	HeightmapGenerator(int width, int height, std::vector<float> heights, Material material)
+		: width{width}, height{height}, heights{std::move(heights)}, material{material} {}
+	void fillSlab(int z, ivec3 size, GLubyte *slab) const override;
+
+private:
+	int width, height;          // Pixels of the map, along x and z
+	std::vector<float> heights; // Stored as [z][x]
+	Material material;
+};
+
+#endif // GENERATORS_HPP
@@ -0,0 +1,99 @@
+#ifndef GLSL_MATH_HPP
+#define GLSL_MATH_HPP
+
+// GLSL built-ins missing from VectorUtils3, so that CPU code can mirror the
+// shaders line by line.
+
+#include "VectorUtils3.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+struct vec2 {
+	GLfloat x, y;
+	vec2() {}
+	vec2(GLfloat x, GLfloat y) : x{x}, y{y} {}
+};
+
+struct ivec3 {
+	int x, y, z;
+	ivec3() {}
+	explicit ivec3(int a) : x{a}, y{a}, z{a} {}
+	ivec3(int x, int y, int z) : x{x}, y{y}, z{z} {}
+	explicit ivec3(vec3 v) : x{int(v.x)}, y{int(v.y)}, z{int(v.z)} {}
+};
+
+inline
+ivec3 operator+(ivec3 a, ivec3 b) {
+	return ivec3(a.x + b.x, a.y + b.y, a.z + b.z);
+}
+
+inline
+ivec3 operator-(ivec3 a, ivec3 b) {
+	return ivec3(a.x - b.x, a.y - b.y, a.z - b.z);
+}
+
+inline
+vec3 toVec3(ivec3 v) {
+	return vec3(v.x, v.y, v.z);
+}
+
+inline
+vec3 mul(vec3 a, vec3 b) {
+	return vec3(a.x * b.x, a.y * b.y, a.z * b.z);
+}
+
+inline
+vec3 min(vec3 a, vec3 b) {
+	return vec3(std::min(a.x, b.x), std::min(a.y, b.y), std::min(a.z, b.z));
+}
+
+inline
+vec3 max(vec3 a, vec3 b) {
+	return vec3(std::max(a.x, b.x), std::max(a.y, b.y), std::max(a.z, b.z));
+}
+
+inline
+vec3 floor(vec3 v) {
+	return vec3(std::floor(v.x), std::floor(v.y), std::floor(v.z));
+}
+
+inline
+vec3 inverse(vec3 v) {
+	return vec3(1.0f / v.x, 1.0f / v.y, 1.0f / v.z);
+}
+
+inline
+float dot(vec3 a, vec3 b) {
+	return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+inline
+float lengthSqrd(vec3 v) {
+	return dot(v, v);
+}
+
+inline
+vec3 normalize(vec3 v) {
+	return v / std::sqrt(lengthSqrd(v));
+}
+
+inline
+vec3 reflect(vec3 i, vec3 n) {
+	return i - 2.0 * dot(n, i) * n;
+}
+
+/**
+ * Returns the refraction direction, or a zero vector on total internal
+ * reflection.
+ */
+inline
+vec3 refract(vec3 i, vec3 n, float eta) {
+	float n_dot_i = dot(n, i);
+	float k = 1.0f - eta * eta * (1.0f - n_dot_i * n_dot_i);
+	if (k < 0.0f) return vec3(0.0);
+	return eta * i - (eta * n_dot_i + std::sqrt(k)) * n;
+}
+
+#endif // GLSL_MATH_HPP
@@ -0,0 +1,93 @@
+#include "gpu-timer.hpp"
+
+#include <algorithm>
+
+
+//----------------------Implementation-----------------------------------------
+
+int GpuTimer::passIndex(const char *name) {
+	for (size_t i = 0; i < stats.size(); ++i) {
+		if (stats[i].name == name) return (int)i;
+	}
+
+	GpuPassStats pass;
+	pass.name = name;
+	stats.push_back(pass);
+
+	PassQueries pass_queries;
+	glGenQueries(GPU_TIMER_FRAMES, pass_queries.begin);
+	glGenQueries(GPU_TIMER_FRAMES, pass_queries.end);
+	std::fill(pass_queries.pending, pass_queries.pending + GPU_TIMER_FRAMES, false);
+	queries.push_back(pass_queries);
+	return (int)stats.size() - 1;
+}
+
+void GpuTimer::beginPass(const char *name) {
+	int index = passIndex(name);
+	PassQueries &pass = queries[index];
+	int buffer = frame % GPU_TIMER_FRAMES;
+	if (pass.pending[buffer]) {
+		// Still unread from an earlier frame, overwritten below
+		pass.pending[buffer] = false;
+		++stats[index].dropped;
+	}
+	glQueryCounter(pass.begin[buffer], GL_TIMESTAMP);
+}
+
+void GpuTimer::endPass(const char *name) {
+	PassQueries &pass = queries[passIndex(name)];
+	int buffer = frame % GPU_TIMER_FRAMES;
+	glQueryCounter(pass.end[buffer], GL_TIMESTAMP);
+	pass.pending[buffer] = true;
+}
+
+void GpuTimer::collect(int buffer, bool wait) {
+	for (size_t i = 0; i < queries.size(); ++i) {
+		PassQueries &pass = queries[i];
+		if (!pass.pending[buffer]) continue;
+
+		if (!wait) {
+			GLint available = 0;
+			glGetQueryObjectiv(pass.end[buffer], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (!available) continue;
+		}
+		GLuint64 begin_ns, end_ns;
+		glGetQueryObjectui64v(pass.begin[buffer], GL_QUERY_RESULT, &begin_ns);
+		glGetQueryObjectui64v(pass.end[buffer], GL_QUERY_RESULT, &end_ns);
+		pass.pending[buffer] = false;
+
+		GpuPassStats &pass_stats = stats[i];
+		double ms = 1e-6 * (double)(end_ns - begin_ns);
+		pass_stats.last_ms = ms;
+		pass_stats.total_ms += ms;
+		pass_stats.min_ms = pass_stats.samples > 0 ? std::min(pass_stats.min_ms, ms) : ms;
+		pass_stats.max_ms = pass_stats.samples > 0 ? std::max(pass_stats.max_ms, ms) : ms;
+		++pass_stats.samples;
+	}
+}
+
+void GpuTimer::endFrame(bool wait) {
+	++frame;
+	// Oldest frame first, the one about to be reused by the next frame
+	for (int i = 0; i < GPU_TIMER_FRAMES; ++i) {
+		collect((frame + i) % GPU_TIMER_FRAMES, wait);
+	}
+}
+
+void GpuTimer::resetStats() {
+	for (GpuPassStats &pass : stats) {
+		pass.last_ms = pass.total_ms = pass.min_ms = pass.max_ms = 0.0;
+		pass.samples = pass.dropped = 0;
+	}
+}
+
+void GpuTimer::logStats(FILE *out) const {
+	fprintf(out, "GPU time:");
+	for (const GpuPassStats &pass : stats) {
+		fprintf(out, "  %s %.3f ms (%.3f-%.3f, %d frames",
+		        pass.name.c_str(), pass.meanMs(), pass.min_ms, pass.max_ms, pass.samples);
+		if (pass.dropped > 0) fprintf(out, ", %d dropped", pass.dropped);
+		fprintf(out, ")");
+	}
+	fprintf(out, "\n");
+}
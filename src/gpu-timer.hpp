@@ -0,0 +1,80 @@
+#ifndef GPU_TIMER_HPP
+#define GPU_TIMER_HPP
+
+#include "gl-import.hpp"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Frames of queries in flight, results are read this many frames - 1 late
+#define GPU_TIMER_FRAMES 2
+
+
+// GPU time spent in one render pass, accumulated since the last reset
+struct GpuPassStats {
+	std::string name;
+	double last_ms = 0.0;
+	double total_ms = 0.0;
+	double min_ms = 0.0;
+	double max_ms = 0.0;
+	int samples = 0;
+	int dropped = 0; // Results not yet available when their queries were reused
+
+	double meanMs() const { return samples > 0 ? total_ms / samples : 0.0; }
+};
+
+
+/**
+ * Measures the GPU time of named render passes with GL_TIMESTAMP queries.
+ * Queries are double-buffered over frames and only read once available, so
+ * timing never stalls the pipeline. Passes may nest or overlap.
+ */
+class GpuTimer {
+
+public:
+	GpuTimer() : frame{0} {}
+
+	/**
+	 * Records the start of the specified pass in the current frame.
+	 * Requires a current GL context.
+	 */
+	void beginPass(const char *name);
+
+	/**
+	 * Records the end of the specified pass in the current frame.
+	 */
+	void endPass(const char *name);
+
+	/**
+	 * Ends the current frame, collecting the results of earlier frames that
+	 * are available. If wait is set, waits for the results of every frame,
+	 * e.g. once rendering is done.
+	 */
+	void endFrame(bool wait = false);
+
+	// Passes in order of their first use
+	const std::vector<GpuPassStats> &getStats() const { return stats; }
+	void resetStats();
+
+	/**
+	 * Prints the mean, min and max time of every pass on one line.
+	 */
+	void logStats(FILE *out) const;
+
+private:
+	struct PassQueries {
+		GLuint begin[GPU_TIMER_FRAMES];
+		GLuint end[GPU_TIMER_FRAMES];
+		bool pending[GPU_TIMER_FRAMES];
+	};
+
+	int passIndex(const char *name);
+	void collect(int buffer, bool wait);
+
+	std::vector<GpuPassStats> stats;
+	std::vector<PassQueries> queries;
+	int frame;
+};
+
+#endif // GPU_TIMER_HPP
@@ -0,0 +1,276 @@
+#include "headless.hpp"
+
+#include "brickmap.hpp"
+#include "camera-block.hpp"
+#include "camera.hpp"
+#include "cpu-renderer.hpp"
+#include "framebuffer.hpp"
+#include "gl-import.hpp"
+#include "gpu-timer.hpp"
+#include "progressive.hpp"
+#include "reprojection.hpp"
+#include "scene.hpp"
+#include "screen-quad.hpp"
+#include "shader-utils.hpp"
+#include "voxel-generator.hpp"
+#include "wavefront-renderer.hpp"
+
+#include "GL_utilities.h"
+
+#ifdef __linux__
+	#include <EGL/egl.h>
+	#include <EGL/eglext.h>
+#endif
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <string>
+
+
+//----------------------Implementation-----------------------------------------
+
+bool initHeadlessContext() {
+#ifdef __linux__
+	PFNEGLGETPLATFORMDISPLAYEXTPROC eglGetPlatformDisplayEXT =
+		(PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	EGLDisplay display = eglGetPlatformDisplayEXT != NULL
+		? eglGetPlatformDisplayEXT(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL)
+		: eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	if (display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL)) {
+		fprintf(stderr, "Failed to initialize EGL display\n");
+		return false;
+	}
+	if (!eglBindAPI(EGL_OPENGL_API)) {
+		fprintf(stderr, "EGL does not support desktop OpenGL\n");
+		return false;
+	}
+	const EGLint attributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 4,
+		EGL_CONTEXT_MINOR_VERSION, 6,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+	EGLContext context = eglCreateContext(display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, attributes);
+	if (context == EGL_NO_CONTEXT) {
+		fprintf(stderr, "Failed to create GL 4.6 context (EGL error 0x%X)\n", eglGetError());
+		return false;
+	}
+	if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+		fprintf(stderr, "Failed to make surfaceless context current (EGL error 0x%X)\n", eglGetError());
+		return false;
+	}
+	return true;
+#else
+	fprintf(stderr, "Headless GL rendering requires EGL, use --cpu instead\n");
+	return false;
+#endif
+}
+
+/**
+ * Renders and saves the requested frames, calling renderFrame for each one
+ * after orbiting the camera and readFrame, if set, before saving it.
+ * Prints per-frame and total render times.
+ */
+static int renderFrames(const Options &options, Camera &camera, Framebuffer &framebuffer,
+                        const std::function<void()> &renderFrame,
+                        const std::function<void()> &readFrame = nullptr)
+{
+	using Clock = std::chrono::steady_clock;
+	double total_ms = 0.0;
+
+	for (int frame = 0; frame < options.frames; ++frame) {
+		if (frame > 0 && options.orbit_step != 0.0) {
+			camera.orbit(options.orbit_step, 0.0);
+		}
+
+		Clock::time_point start = Clock::now();
+		renderFrame();
+		double frame_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		total_ms += frame_ms;
+		printf("Frame %d: %.3f ms\n", frame, frame_ms);
+
+		if (!options.output.empty()) {
+			if (readFrame) readFrame();
+			char filename[32];
+			snprintf(filename, sizeof(filename), "-%04d.tga", frame);
+			std::string path = options.output + filename;
+			if (!framebuffer.saveTGA(path.c_str())) {
+				fprintf(stderr, "Failed to write %s\n", path.c_str());
+				return 1;
+			}
+		}
+	}
+
+	double pixels = (double)framebuffer.width * framebuffer.height * options.frames;
+	printf("%d frames in %.3f ms: %.3f ms/frame, %.2f frames/s, %.2f Mpixels/s\n",
+	       options.frames, total_ms, total_ms / options.frames,
+	       1000.0 * options.frames / total_ms, 0.001 * pixels / total_ms);
+	return 0;
+}
+
+static int runCpu(const Options &options) {
+	VoxelGrid voxels = createScene(options);
+	Brickmap brickmap;
+	if (options.structure == VoxelStructure::BRICKMAP) {
+		brickmap = Brickmap(voxels);
+	}
+	MortonGrid morton;
+	if (options.layout == VoxelLayout::MORTON) {
+		morton = MortonGrid(voxels);
+	}
+	const MortonGrid *cpu_morton = options.layout == VoxelLayout::MORTON ? &morton : nullptr;
+	CpuRenderer renderer(voxels, options.structure == VoxelStructure::BRICKMAP ? &brickmap : nullptr);
+	renderer.setMortonGrid(cpu_morton);
+	renderer.setMinRayWeight(options.min_ray_weight);
+	LightVolume light_volume;
+	if (options.baked_shadows) {
+		light_volume = bakeLightVolume(voxels, cpu_morton);
+		renderer.setLightVolume(&light_volume);
+	}
+	Framebuffer framebuffer(options.width, options.height);
+
+	Camera camera(options.camera_x, options.camera_y, voxels.size);
+	if (options.camera_zoom > 0.0) camera.setZoom(options.camera_zoom);
+
+	return renderFrames(options, camera, framebuffer, [&]() {
+		renderer.render(camera.getCameraToWorldMatrix(), camera.getViewPos(), framebuffer);
+	});
+}
+
+static int runGpu(const Options &options) {
+	if (!initHeadlessContext()) {
+		return 1;
+	}
+	dumpInfo();
+
+	GLuint shader = loadShaders("shaders/raytracing.vert", "shaders/raytracing.frag");
+	glUseProgram(shader);
+	printError("init shader");
+
+	VoxelGrid voxels = createScene(options);
+	initVoxels(shader, voxels, options.structure);
+	glUniform1f(uniformLoc(shader, "min_ray_weight"), options.min_ray_weight);
+	LightVolume light_volume;
+	MortonGrid morton; // Marched by the bake with --layout morton
+	if (options.baked_shadows) {
+		if (options.layout == VoxelLayout::MORTON) morton = MortonGrid(voxels);
+		light_volume = bakeLightVolume(voxels, options.layout == VoxelLayout::MORTON ? &morton : nullptr);
+		light_volume.upload(shader);
+	}
+	printError("init voxels");
+
+	Model *square_model = createScreenQuad();
+	printError("init model");
+
+	// Every frame averages this many jittered samples
+	Progressive progressive;
+	progressive.setMaxSamples(options.samples > 0 ? options.samples : 1);
+	progressive.resize(options.width, options.height);
+
+	// Reuses the last frame for the first sample of every frame
+	Reprojection reprojection;
+	bool reprojecting = options.reprojection == 1;
+	if (reprojecting) {
+		reprojection.resize(options.width, options.height);
+		reprojection.attach(progressive.getFramebuffer());
+	}
+	GLfloat screen_ratio = (GLfloat) options.width / (GLfloat) options.height;
+
+	// Render target replacing the window
+	FBOstruct *fbo = initFBO2(options.width, options.height, 0, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo->fb);
+	glViewport(0, 0, options.width, options.height);
+	printError("init framebuffer");
+
+	Camera camera(options.camera_x, options.camera_y, voxels.size);
+	CameraBlock camera_block;
+	if (options.camera_zoom > 0.0) camera.setZoom(options.camera_zoom);
+	printError("init camera");
+
+	Framebuffer framebuffer(options.width, options.height);
+	GpuTimer gpu_timer;
+	int result = renderFrames(options, camera, framebuffer, [&]() {
+		for (progressive.reset(); !progressive.isConverged(); ) {
+			camera_block.upload(camera, screen_ratio, progressive.getJitter(), options.width, options.height);
+			progressive.beginSample();
+			if (reprojecting) reprojection.beginFrame(shader, progressive.getSampleCount() == 0);
+			gpu_timer.beginPass("raytrace");
+			DrawModel(square_model, shader, "in_pos", NULL, NULL);
+			gpu_timer.endPass("raytrace");
+			if (reprojecting) {
+				reprojection.endFrame(progressive.getFramebuffer(), options.width, options.height,
+				                      camera.getCameraToWorldMatrix(), camera.getViewPos(), screen_ratio);
+			}
+			progressive.endSample(fbo->fb);
+			glFinish();
+			gpu_timer.endFrame();
+		}
+	}, [&]() {
+		framebuffer.readPixels();
+	});
+	gpu_timer.endFrame(true);
+	if (options.gpu_timing) gpu_timer.logStats(stdout);
+	printError("render");
+	return result;
+}
+
+static int runWavefront(const Options &options) {
+	if (!initHeadlessContext()) {
+		return 1;
+	}
+	dumpInfo();
+
+	WavefrontRenderer renderer;
+	if (!renderer.init()) {
+		return 1;
+	}
+	VoxelGrid voxels = createScene(options);
+	renderer.setVoxels(voxels, options.structure);
+	renderer.setMinRayWeight(options.min_ray_weight);
+	LightVolume light_volume;
+	MortonGrid morton; // Marched by the bake with --layout morton
+	if (options.baked_shadows) {
+		if (options.layout == VoxelLayout::MORTON) morton = MortonGrid(voxels);
+		light_volume = bakeLightVolume(voxels, options.layout == VoxelLayout::MORTON ? &morton : nullptr);
+		renderer.setLightVolume(light_volume);
+	}
+	printError("init voxels");
+
+	// Render target replacing the window
+	FBOstruct *fbo = initFBO2(options.width, options.height, 0, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo->fb);
+	renderer.resize(options.width, options.height);
+	printError("init framebuffer");
+
+	Camera camera(options.camera_x, options.camera_y, voxels.size);
+	CameraBlock camera_block;
+	if (options.camera_zoom > 0.0) camera.setZoom(options.camera_zoom);
+	printError("init camera");
+
+	Framebuffer framebuffer(options.width, options.height);
+	GpuTimer gpu_timer;
+	Progressive progressive;
+	progressive.setMaxSamples(options.samples > 0 ? options.samples : 1);
+	int result = renderFrames(options, camera, framebuffer, [&]() {
+		for (progressive.reset(); !progressive.isConverged(); progressive.addSample()) {
+			camera_block.upload(camera, (GLfloat) options.width / (GLfloat) options.height,
+			                    progressive.getJitter(), options.width, options.height);
+			renderer.setSampleCount(progressive.getSampleCount());
+			renderer.render(&gpu_timer);
+			glFinish();
+			gpu_timer.endFrame();
+		}
+	}, [&]() {
+		framebuffer.readPixels();
+	});
+	gpu_timer.endFrame(true);
+	if (options.gpu_timing) gpu_timer.logStats(stdout);
+	printError("render");
+	return result;
+}
+
+int runHeadless(const Options &options) {
+	if (options.cpu) return runCpu(options);
+	return options.wavefront ? runWavefront(options) : runGpu(options);
+}
@@ -0,0 +1,23 @@
+#ifndef HEADLESS_HPP
+#define HEADLESS_HPP
+
+#include "options.hpp"
+
+
+/**
+ * Makes a surfaceless GL 4.6 core context current.
+ *
+ * Returns true on success or false otherwise.
+ */
+bool initHeadlessContext();
+
+/**
+ * Renders options.frames frames offscreen, without a window system, either
+ * through a surfaceless EGL context or on the CPU. Frames are saved as TGA
+ * files if options.output is set, and frame times are reported.
+ *
+ * Returns the process exit code.
+ */
+int runHeadless(const Options &options);
+
+#endif // HEADLESS_HPP
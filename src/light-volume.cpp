@@ -0,0 +1,217 @@
+#include "light-volume.hpp"
+
+#include "cpu-raycasting.hpp"
+#include "materials.hpp"
+#include "parallel.hpp"
+#include "shader-utils.hpp"
+#include "simd-math.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+
+//----------------------Implementation-----------------------------------------
+
+/**
+ * Returns the world position of the center of the specified volume cell.
+ */
+static vec3 cellCenter(ivec3 cell) {
+	return (toVec3(cell) - vec3(0.5)) * VOXEL_WIDTH;
+}
+
+/**
+ * Returns, per lane, whether the segment from a to the point of b in that
+ * lane intersects the box [lo, hi].
+ */
+static intx4 segmentsIntersectBox(vec3 a, const vec3x4 &b, vec3 lo, vec3 hi) {
+	floatx4 t_min = splat<floatx4>(0.0);
+	floatx4 t_max = splat<floatx4>(1.0);
+	intx4 intersects = splat<intx4>(-1);
+	for (int axis = 0; axis < 3; ++axis) {
+		float o = (&a.x)[axis];
+		floatx4 d = (&b.x)[axis] - o;
+		float box_lo = (&lo.x)[axis];
+		float box_hi = (&hi.x)[axis];
+
+		// Segments parallel to the slab must start within it
+		intx4 parallel = d == 0.0f;
+		if (o < box_lo || o > box_hi) intersects &= ~parallel;
+
+		floatx4 t0 = (box_lo - o) / d;
+		floatx4 t1 = (box_hi - o) / d;
+		t_min = select(parallel, t_min, max(t_min, min(t0, t1)));
+		t_max = select(parallel, t_max, min(t_max, max(t0, t1)));
+	}
+	return intersects & (t_min <= t_max);
+}
+
+LightVolume::LightVolume(const VoxelGrid &grid, const MortonGrid *morton)
+	: size{0}, morton{morton}, texture{0}, baked_cells{0}
+{
+	bake(grid, placeLights(grid.size));
+}
+
+bool LightVolume::isBoundary(const VoxelGrid &grid, ivec3 cell) const {
+	ivec3 voxel = cell - ivec3(1);
+	int value = getVoxelValue(grid, voxel);
+	if (materials[value].refractivity <= 0.0) {
+		// Opaque, shadow rays never start here
+		return false;
+	}
+	static const ivec3 NEIGHBORS[6] = {
+		ivec3(-1, 0, 0), ivec3(1, 0, 0), ivec3(0, -1, 0),
+		ivec3(0, 1, 0), ivec3(0, 0, -1), ivec3(0, 0, 1)
+	};
+	for (const ivec3 &offset : NEIGHBORS) {
+		if (getVoxelValue(grid, voxel + offset) != value) return true;
+	}
+	return false;
+}
+
+void LightVolume::bakeCell(const VoxelGrid &grid, ivec3 cell, int light) {
+	vec3 origin = cellCenter(cell);
+	vec3 light_offset = lights[light].pos - origin;
+	float distance = std::sqrt(lengthSqrd(light_offset));
+	Ray shadow_ray = Ray(origin, light_offset / distance);
+
+	RaymarchVoxelHit shadow_hit;
+	bool blocked = morton ? raymarchVoxelsOpaque(*morton, shadow_ray, shadow_hit, STD_VOID_INDEX, distance)
+	                      : raymarchVoxelsOpaque(grid, shadow_ray, shadow_hit, STD_VOID_INDEX, distance);
+	float transparency = blocked ? 0.0f : shadow_hit.transparency;
+	visibility[4 * cellIndex(cell) + light] = (GLubyte)(std::min(std::max(transparency, 0.0f), 1.0f) * 255.0f + 0.5f);
+}
+
+void LightVolume::markDirty(ivec3 lo, ivec3 hi) {
+	dirty_lo = ivec3(std::min(dirty_lo.x, lo.x), std::min(dirty_lo.y, lo.y), std::min(dirty_lo.z, lo.z));
+	dirty_hi = ivec3(std::max(dirty_hi.x, hi.x), std::max(dirty_hi.y, hi.y), std::max(dirty_hi.z, hi.z));
+}
+
+void LightVolume::bake(const VoxelGrid &grid, const std::vector<PointLight> &new_lights) {
+	lights.assign(new_lights.begin(), new_lights.begin() + std::min((int)new_lights.size(), LIGHT_VOLUME_MAX_LIGHTS));
+	size = grid.size + ivec3(2);
+	visibility.assign(4 * (size_t)size.x * size.y * size.z, 0);
+
+	std::atomic<int> cells{0};
+	parallelFor(size.z, [&](int z) {
+		int slice_cells = 0;
+		for (int y = 0; y < size.y; ++y) {
+			for (int x = 0; x < size.x; ++x) {
+				ivec3 cell = ivec3(x, y, z);
+				if (!isBoundary(grid, cell)) continue;
+				for (int light = 0; light < (int)lights.size(); ++light) {
+					bakeCell(grid, cell, light);
+				}
+				++slice_cells;
+			}
+		}
+		cells += slice_cells;
+	});
+	baked_cells = cells;
+
+	dirty_lo = ivec3(0);
+	dirty_hi = size - ivec3(1);
+}
+
+void LightVolume::update(const VoxelGrid &grid, ivec3 lo, ivec3 hi) {
+	// Cells whose boundary state may have changed, in volume coordinates
+	ivec3 near_lo = lo;
+	ivec3 near_hi = hi + ivec3(2);
+	// Grown slightly, so that shadow rays grazing the region are rebaked too
+	vec3 box_lo = (toVec3(lo) - vec3(0.01)) * VOXEL_WIDTH;
+	vec3 box_hi = (toVec3(hi + ivec3(1)) + vec3(0.01)) * VOXEL_WIDTH;
+
+	// Light positions in lanes, to test the segments towards all lights of
+	// a cell at once
+	vec3x4 light_positions = vec3x4(vec3(0.0));
+	for (int light = 0; light < (int)lights.size(); ++light) {
+		light_positions.setLane(light, lights[light].pos);
+	}
+
+	std::atomic<int> cells{0};
+	std::vector<ivec3> slice_lo(size.z, size);
+	std::vector<ivec3> slice_hi(size.z, ivec3(-1));
+	parallelFor(size.z, [&](int z) {
+		int slice_cells = 0;
+		ivec3 &changed_lo = slice_lo[z];
+		ivec3 &changed_hi = slice_hi[z];
+		for (int y = 0; y < size.y; ++y) {
+			for (int x = 0; x < size.x; ++x) {
+				ivec3 cell = ivec3(x, y, z);
+				bool near = x >= near_lo.x && y >= near_lo.y && z >= near_lo.z
+				         && x <= near_hi.x && y <= near_hi.y && z <= near_hi.z;
+				bool boundary = isBoundary(grid, cell);
+				intx4 affected = near ? splat<intx4>(-1)
+				                      : segmentsIntersectBox(cellCenter(cell), light_positions, box_lo, box_hi);
+				bool changed = false;
+				for (int light = 0; light < (int)lights.size(); ++light) {
+					if (!affected[light]) continue;
+					if (boundary) {
+						bakeCell(grid, cell, light);
+					} else {
+						visibility[4 * cellIndex(cell) + light] = 0;
+					}
+					changed = true;
+				}
+				if (!changed) continue;
+				if (boundary) ++slice_cells;
+				changed_lo = ivec3(std::min(changed_lo.x, x), std::min(changed_lo.y, y), std::min(changed_lo.z, z));
+				changed_hi = ivec3(std::max(changed_hi.x, x), std::max(changed_hi.y, y), std::max(changed_hi.z, z));
+			}
+		}
+		cells += slice_cells;
+	});
+	baked_cells = cells;
+
+	for (int z = 0; z < size.z; ++z) {
+		if (slice_lo[z].z <= slice_hi[z].z) markDirty(slice_lo[z], slice_hi[z]);
+	}
+}
+
+float LightVolume::getVisibility(vec3 world_pos, int light) const {
+	vec3 voxel = world_pos / VOXEL_WIDTH;
+	ivec3 cell = ivec3((int)std::floor(voxel.x) + 1, (int)std::floor(voxel.y) + 1, (int)std::floor(voxel.z) + 1);
+	if (cell.x < 0 || cell.y < 0 || cell.z < 0 || cell.x >= size.x || cell.y >= size.y || cell.z >= size.z) {
+		return 0.0;
+	}
+	return visibility[4 * cellIndex(cell) + light] / 255.0f;
+}
+
+void LightVolume::upload(GLuint shader) {
+	glActiveTexture(GL_TEXTURE0 + LIGHT_VOLUME_TEXTURE_UNIT);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	if (texture == 0) {
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_3D, texture);
+		glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+		glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA8, size.x, size.y, size.z, 0,
+		             GL_RGBA, GL_UNSIGNED_BYTE, visibility.data());
+	} else if (dirty_lo.x <= dirty_hi.x) {
+		// Only the changed box, read in place from the full volume
+		ivec3 box = dirty_hi - dirty_lo + ivec3(1);
+		glBindTexture(GL_TEXTURE_3D, texture);
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, size.x);
+		glPixelStorei(GL_UNPACK_IMAGE_HEIGHT, size.y);
+		glPixelStorei(GL_UNPACK_SKIP_PIXELS, dirty_lo.x);
+		glPixelStorei(GL_UNPACK_SKIP_ROWS, dirty_lo.y);
+		glPixelStorei(GL_UNPACK_SKIP_IMAGES, dirty_lo.z);
+		glTexSubImage3D(GL_TEXTURE_3D, 0, dirty_lo.x, dirty_lo.y, dirty_lo.z, box.x, box.y, box.z,
+		                GL_RGBA, GL_UNSIGNED_BYTE, visibility.data());
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+		glPixelStorei(GL_UNPACK_IMAGE_HEIGHT, 0);
+		glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+		glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+		glPixelStorei(GL_UNPACK_SKIP_IMAGES, 0);
+	}
+	glActiveTexture(GL_TEXTURE0);
+	dirty_lo = size;
+	dirty_hi = ivec3(-1);
+
+	glUseProgram(shader);
+	glUniform1i(uniformLoc(shader, "light_volume_tex"), LIGHT_VOLUME_TEXTURE_UNIT);
+	glUniform1i(uniformLoc(shader, "baked_shadows"), GL_TRUE);
+}
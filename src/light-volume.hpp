@@ -0,0 +1,92 @@
+#ifndef LIGHT_VOLUME_HPP
+#define LIGHT_VOLUME_HPP
+
+#include "gl-import.hpp"
+#include "glsl-math.hpp"
+#include "lights.hpp"
+#include "morton-grid.hpp"
+#include "voxel-grid.hpp"
+
+#include <vector>
+
+// Texture unit of light_volume_tex, see shaders/raytracing.frag
+#define LIGHT_VOLUME_TEXTURE_UNIT 2
+
+// Lights baked, one per texel channel. Shadow rays are marched to the rest.
+// Also the lanes of vec3x4 that update() tests the lights in.
+#define LIGHT_VOLUME_MAX_LIGHTS 4
+
+
+/**
+ * Baked visibility of every light from every cell a shadow ray can start in,
+ * i.e. the min transparency along the way or 0 if blocked, as marched by
+ * raymarchVoxelsOpaque from the cell center. The volume pads the grid by one
+ * cell per side, for shadow rays starting just outside it, and stores one
+ * of the first LIGHT_VOLUME_MAX_LIGHTS lights per channel of an RGBA texel.
+ *
+ * Only non-opaque cells next to a cell of another value are baked, since
+ * every hit is found on such a boundary. Other cells read as unlit.
+ */
+class LightVolume {
+
+public:
+	LightVolume() : size{0}, morton{nullptr}, texture{0}, baked_cells{0} {}
+
+	/**
+	 * Bakes the visibility of the lights placed around the specified grid.
+	 * Shadow rays are marched through the specified copy of the grid in the
+	 * Morton layout if one is given, here and in later bakes and updates,
+	 * which must then see it match the grid.
+	 */
+	explicit LightVolume(const VoxelGrid &grid, const MortonGrid *morton = nullptr);
+
+	/**
+	 * Rebakes every cell for the specified lights, e.g. after they moved.
+	 */
+	void bake(const VoxelGrid &grid, const std::vector<PointLight> &lights);
+
+	/**
+	 * Rebakes the cells affected by a change to the voxels in [lo, hi] of
+	 * the specified grid: those on a boundary in or next to the region, and
+	 * those whose shadow rays pass through it.
+	 */
+	void update(const VoxelGrid &grid, ivec3 lo, ivec3 hi);
+
+	/**
+	 * Returns the baked visibility of the specified light, which must be one
+	 * of the first LIGHT_VOLUME_MAX_LIGHTS, from the cell containing the
+	 * specified position, or 0 outside the volume.
+	 */
+	float getVisibility(vec3 world_pos, int light) const;
+
+	// Cells baked by the last bake or update
+	int getBakedCellCount() const { return baked_cells; }
+
+	/**
+	 * Uploads the volume to a 3D texture bound to LIGHT_VOLUME_TEXTURE_UNIT
+	 * and enables baked shadows in the specified program. After the first
+	 * call, only the box of cells changed since the last call is sent.
+	 */
+	void upload(GLuint shader);
+
+private:
+	size_t cellIndex(ivec3 cell) const {
+		return ((size_t)cell.z * size.y + cell.y) * size.x + cell.x;
+	}
+	bool isBoundary(const VoxelGrid &grid, ivec3 cell) const;
+	void bakeCell(const VoxelGrid &grid, ivec3 cell, int light);
+	void markDirty(ivec3 lo, ivec3 hi);
+
+	ivec3 size;                    // Grid size + 2
+	const MortonGrid *morton;      // Marched instead of the grid if set
+	std::vector<GLubyte> visibility; // RGBA per cell, one light per channel
+	std::vector<PointLight> lights; // Only the baked ones
+	GLuint texture;
+	int baked_cells;
+
+	// Box of cells not yet uploaded, empty if dirty_lo > dirty_hi
+	ivec3 dirty_lo;
+	ivec3 dirty_hi;
+};
+
+#endif // LIGHT_VOLUME_HPP
@@ -0,0 +1,45 @@
+#include "lights.hpp"
+
+#include "voxel-grid.hpp"
+
+
+//----------------------Globals------------------------------------------------
+
+static GLuint light_buffer = 0;
+static size_t uploaded_count = 0; // Lights the buffer has room for
+
+
+//----------------------Implementation-----------------------------------------
+
+std::vector<PointLight> placeLights(ivec3 grid_size) {
+	vec3 space_size = toVec3(grid_size) * VOXEL_WIDTH;
+	float space_width = std::max(std::max(space_size.x, space_size.y), space_size.z);
+	vec3 space_center = 0.5 * space_size;
+	float light_intencity = space_width * space_width;
+
+	return {
+		PointLight(space_center + space_width * vec3(0.9, 0.8, 1.0),
+		           1.5 * light_intencity * vec3(1.0, 0.8, 0.7)),
+		PointLight(space_center + space_width * vec3(-0.7, 0.6, 1.0),
+		           light_intencity * vec3(0.7, 0.8, 1.0)),
+		PointLight(space_center + mul(0.5 * space_size - vec3(1.5 * VOXEL_WIDTH), vec3(1.0, -0.4, 1.0)),
+		           0.5 * light_intencity * vec3(0.75, 1.0, 0.75))
+	};
+}
+
+void uploadLights(const std::vector<PointLight> &lights) {
+	if (light_buffer == 0) glGenBuffers(1, &light_buffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, light_buffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, lights.size() * sizeof(PointLight), lights.data(), GL_DYNAMIC_DRAW);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LIGHTS_BINDING, light_buffer);
+	uploaded_count = lights.size();
+}
+
+void updateLight(const std::vector<PointLight> &lights, int index) {
+	if (light_buffer == 0 || (size_t)index >= uploaded_count || lights.size() != uploaded_count) {
+		uploadLights(lights);
+		return;
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, light_buffer);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, index * sizeof(PointLight), sizeof(PointLight), &lights[index]);
+}
@@ -0,0 +1,43 @@
+#ifndef LIGHTS_HPP
+#define LIGHTS_HPP
+
+#include "gl-import.hpp"
+#include "glsl-math.hpp"
+
+#include "VectorUtils3.h"
+
+#include <vector>
+
+// Shader storage binding of the lights, see shaders/raytracing.frag
+#define LIGHTS_BINDING 4
+
+// Laid out as the std430 PointLight struct in shaders/raytracing.frag
+struct PointLight {
+	vec3 pos;
+	GLfloat pos_pad;
+	vec3 intensity;
+	GLfloat intensity_pad;
+
+	PointLight() {}
+	PointLight(vec3 pos, vec3 intensity) : pos{pos}, pos_pad{0.0}, intensity{intensity}, intensity_pad{0.0} {}
+};
+static_assert(sizeof(PointLight) == 32, "PointLight must match std430 PointLight");
+
+/**
+ * Returns the default lights around a grid of the specified size.
+ */
+std::vector<PointLight> placeLights(ivec3 grid_size);
+
+/**
+ * Uploads the specified lights to a shader storage buffer bound to
+ * LIGHTS_BINDING.
+ */
+void uploadLights(const std::vector<PointLight> &lights);
+
+/**
+ * Sends only the specified one of the specified lights, or all of them if
+ * their count changed since the last upload.
+ */
+void updateLight(const std::vector<PointLight> &lights, int index);
+
+#endif // LIGHTS_HPP
@@ -1,49 +1,114 @@
 
+#include "benchmark.hpp"
+#include "brickmap.hpp"
+#include "camera-block.hpp"
 #include "camera.hpp"
+#include "cpu-raycasting.hpp"
+#include "cpu-renderer.hpp"
+#include "dynamic-resolution.hpp"
 #include "gl-import.hpp"
+#include "gpu-timer.hpp"
+#include "headless.hpp"
+#include "lights.hpp"
+#include "options.hpp"
+#include "progressive.hpp"
+#include "reprojection.hpp"
+#include "scene.hpp"
+#include "screen-quad.hpp"
 #include "shader-utils.hpp"
+#include "shader-variants.hpp"
+#include "voxel-editor.hpp"
 #include "voxel-generator.hpp"
+#include "wavefront-renderer.hpp"
 
 #include "GL_utilities.h"
 #include "loadobj.h"
 #include "VectorUtils3.h"
 
+#include <chrono>
 
-//----------------------Constants----------------------------------------------
 
-// initial width and heights
-#define W 512
-#define H 512
+//----------------------Constants----------------------------------------------
 
 #define CLEAR_COLOR vec3(0.1, 0.1, 0.3)
 
+#define TIMING_LOG_INTERVAL_MS 1000 // With --gpu-timing
 
-//----------------------Square Model-------------------------------------------
+#define VIEW_IDLE_MS 150 // Without changes before a moving view is refined at full resolution
 
-GLfloat square_vertices[] = {-1.0,-1.0, 0.0,
-                             -1.0, 1.0, 0.0,
-                              1.0, 1.0, 0.0,
-                              1.0,-1.0, 0.0};
-GLfloat square_tex_coords[] = {0.0, 0.0,
-                               0.0, 1.0,
-                               1.0, 1.0,
-                               1.0, 0.0};
-GLuint square_indices[] = {0, 1, 2, 0, 2, 3};
-Model* square_model;
+#define EDIT_BRUSH_RADIUS 2.5 // In voxels
 
 
 //----------------------Globals------------------------------------------------
 
-GLuint shader = 0;
-Camera camera;
+Options options;
+
+Model* square_model;
+GLuint shader = 0; // Full quality
 
-int frame_time_ms = 5;
+// Programs of the fragment shader path, with a lower ray depth while moving
+ShaderVariants shader_variants;
+int preview_variant = -1; // None if -1
+Camera camera;
+CameraBlock camera_block; // The view of the frame, shared by every program
+VoxelGrid voxels;
+LightVolume light_volume; // With --baked-shadows
+
+// Digs with the right mouse button and builds with the middle one
+VoxelEditor voxel_editor;
+int edit_button = -1; // Held button editing while dragged, -1 if none
+
+// Software rendering on the CPU, displayed through a framebuffer blit
+Brickmap cpu_brickmap;
+MortonGrid cpu_morton; // With --layout morton, for the CPU and light baking
+CpuRenderer cpu_renderer;
+Framebuffer cpu_framebuffer;
+GLuint cpu_frame_tex = 0;
+GLuint cpu_frame_fbo = 0;
+
+int frame_time_ms = 5; // Between updates while a key is held
 int last_time_ms = 0;
+bool updating = false; // Whether onTimer is scheduled
+
+WavefrontRenderer wavefront_renderer; // With --wavefront
+
+// Refines a static view on the GPU over frames
+Progressive progressive;
+
+// Reuses the last frame while the view changes, with the fragment shader
+Reprojection reprojection;
+bool reprojecting = false;
+
+// Traces at a lower resolution while the view changes, to keep within budget
+DynamicResolution dynamic_resolution;
+bool view_changed = true; // Since the last frame
+int last_view_change_ms = -VIEW_IDLE_MS;
+bool idle_check_pending = false; // Whether onViewIdle is scheduled
+int window_width = 0;
+int window_height = 0;
+
+GpuTimer gpu_timer;
+int last_timing_log_ms = 0;
 
 //----------------------Implementation-----------------------------------------
 
+/**
+ * Requests a redraw if the camera moved, starting progressive refinement
+ * over. The window is otherwise only redrawn when it is exposed or resized,
+ * when the voxels change, or until a static view has converged, so the main
+ * loop sleeps while nothing changes.
+ */
+void redrawIfChanged() {
+	if (camera.takeChanged()) {
+		view_changed = true;
+		progressive.reset();
+		glutPostRedisplay();
+	}
+}
+
 void update(float delta_t) {
 	camera.update(delta_t);
+	redrawIfChanged();
 }
 
 void onTimer(int value)
@@ -52,8 +117,78 @@ void onTimer(int value)
 	float delta_t = 0.001 * (time_ms - last_time_ms);
 	last_time_ms = time_ms;
 	update(delta_t);
+
+	// Keep updating only while a key moves the camera
+	updating = camera.isZooming();
+	if (updating) glutTimerFunc(frame_time_ms, &onTimer, value);
+}
+
+/**
+ * Redraws once the view has been idle for VIEW_IDLE_MS, to switch from the
+ * dynamic resolution and preview to full quality.
+ */
+void onViewIdle(int value)
+{
+	int idle_ms = glutGet(GLUT_ELAPSED_TIME) - last_view_change_ms;
+	if (idle_ms < VIEW_IDLE_MS) {
+		glutTimerFunc(VIEW_IDLE_MS - idle_ms, &onViewIdle, value);
+	} else {
+		idle_check_pending = false;
+		glutPostRedisplay();
+	}
+}
+
+/**
+ * Updates the structures derived from the voxels after edits, and redraws
+ * as after a change of view.
+ */
+void applyEdits() {
+	if (!voxel_editor.update()) return;
+	view_changed = true;
+	progressive.reset();
+	reprojection.invalidate();
 	glutPostRedisplay();
-	glutTimerFunc(frame_time_ms, &onTimer, value);
+}
+
+/**
+ * Digs or builds, as chosen by edit_button, where the ray through the
+ * specified window position first hits a non-void voxel.
+ */
+void editAt(int x, int y) {
+	// Same primary ray as raytracing.vert, with y pointing down in the window
+	vec3 in_pos = vec3(2.0 * (x + 0.5) / window_width - 1.0, 1.0 - 2.0 * (y + 0.5) / window_height, 0.0);
+	GLfloat screen_ratio = (GLfloat) window_width / (GLfloat) window_height;
+	vec3 ray_origin = camera.getCameraToWorldMatrix() * vec3(screen_ratio * in_pos.x, in_pos.y, in_pos.z);
+	Ray ray = Ray(ray_origin, normalize(ray_origin - camera.getViewPos()));
+
+	RaymarchVoxelHit hit;
+	if (!raymarchVoxelsDifferent(voxels, ray, hit, STD_VOID_INDEX)) return;
+	vec3 hit_center = toVec3(hit.voxel_coords) + vec3(0.5);
+	if (edit_button == GLUT_RIGHT_BUTTON) {
+		voxel_editor.fillSphere(hit_center, EDIT_BRUSH_RADIUS, STD_VOID_INDEX);
+	} else {
+		// Centered on the void voxel in front of the hit face
+		voxel_editor.fillSphere(hit_center + hit.normal, EDIT_BRUSH_RADIUS, (GLubyte)Material::SOLID);
+	}
+	applyEdits();
+}
+
+/**
+ * Sets the uniforms of a variant of the fragment shader program, which all
+ * share the voxels and the settings.
+ */
+void setupProgram(GLuint program) {
+	setVoxelUniforms(program, voxels.size, options.structure);
+	glUniform1f(uniformLoc(program, "min_ray_weight"), options.min_ray_weight);
+	if (options.baked_shadows) light_volume.upload(program);
+	printError("setup program");
+}
+
+void startUpdates() {
+	if (updating) return;
+	updating = true;
+	last_time_ms = glutGet(GLUT_ELAPSED_TIME);
+	glutTimerFunc(frame_time_ms, &onTimer, 0);
 }
 
 void init(void)
@@ -67,51 +202,237 @@ void init(void)
 	glDisable(GL_CULL_FACE);
 	printError("GL inits");
 
-	// Load and compile shaders
-	shader = loadShaders("shaders/raytracing.vert", "shaders/raytracing.frag");
-	glUseProgram(shader);
-	printError("init shader");
-
-	initVoxels(shader);
-	printError("init voxels");
-
-	// Load model
-	square_model = LoadDataToModel(
-		square_vertices, NULL, square_tex_coords, NULL,
-		square_indices, 4, 6);
-	printError("init model");
-
-	camera = Camera(0.2*M_PI, -0.125*M_PI, shader);
+	window_width = options.width;
+	window_height = options.height;
+	voxels = createScene(options);
+	voxel_editor = VoxelEditor(voxels, options.structure);
+	// A second copy of the grid, read only by the CPU renderer and the bake
+	const MortonGrid *morton = nullptr;
+	if (options.layout == VoxelLayout::MORTON && (options.cpu || options.baked_shadows)) {
+		cpu_morton = MortonGrid(voxels);
+		morton = &cpu_morton;
+		voxel_editor.setMortonGrid(&cpu_morton);
+	}
+	if (options.baked_shadows) {
+		light_volume = bakeLightVolume(voxels, morton);
+		voxel_editor.setLightVolume(&light_volume);
+	}
+
+	if (options.cpu) {
+		if (options.structure == VoxelStructure::BRICKMAP) {
+			cpu_brickmap = Brickmap(voxels);
+			cpu_renderer = CpuRenderer(voxels, &cpu_brickmap);
+			voxel_editor.setBrickmap(&cpu_brickmap);
+		} else {
+			cpu_renderer = CpuRenderer(voxels);
+		}
+		cpu_renderer.setMortonGrid(morton);
+		cpu_renderer.setMinRayWeight(options.min_ray_weight);
+		if (options.baked_shadows) cpu_renderer.setLightVolume(&light_volume);
+		cpu_framebuffer.resize(options.width, options.height);
+
+		// Target for uploading CPU frames, blitted to the window
+		glGenTextures(1, &cpu_frame_tex);
+		glBindTexture(GL_TEXTURE_2D, cpu_frame_tex);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glGenFramebuffers(1, &cpu_frame_fbo);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		printError("init cpu renderer");
+	} else if (options.wavefront) {
+		if (!wavefront_renderer.init()) exit(1);
+		wavefront_renderer.setVoxels(voxel_editor);
+		wavefront_renderer.setMinRayWeight(options.min_ray_weight);
+		if (options.baked_shadows) wavefront_renderer.setLightVolume(light_volume);
+		wavefront_renderer.resize(options.width, options.height);
+		printError("init wavefront renderer");
+	} else {
+		// Load and compile shaders, the preview variant in the background
+		int light_count = placeLights(voxels.size).size();
+		shader_variants = ShaderVariants("shaders/raytracing.vert", "shaders/raytracing.frag", setupProgram);
+		shader = shader_variants.getProgram(shader_variants.add(shadingDefines(-1, light_count), true));
+		if (options.preview_depth >= 0) {
+			preview_variant = shader_variants.add(shadingDefines(options.preview_depth, light_count), false);
+		}
+		printError("init shader");
+
+		voxel_editor.initGpu(shader);
+		printError("init voxels");
+
+		// Load model
+		square_model = createScreenQuad();
+		printError("init model");
+
+		progressive.resize(options.width, options.height);
+		reprojecting = options.reprojection != 0;
+		if (reprojecting) {
+			reprojection.resize(options.width, options.height);
+			reprojection.attach(progressive.getFramebuffer());
+		}
+		printError("init progressive");
+	}
+
+	progressive.setMaxSamples(options.samples > 0 ? options.samples : PROGRESSIVE_SAMPLES);
+	dynamic_resolution.setBudget(options.frame_budget_ms);
+	dynamic_resolution.resize(window_width, window_height);
+
+	camera = Camera(options.camera_x, options.camera_y, voxels.size);
+	if (options.camera_zoom > 0.0) camera.setZoom(options.camera_zoom);
 	printError("init camera");
+}
 
-	glutTimerFunc(5, &onTimer, 0);
+void displayCpu(int render_width, int render_height)
+{
+	if (cpu_framebuffer.width != render_width || cpu_framebuffer.height != render_height) {
+		cpu_framebuffer.resize(render_width, render_height);
+	}
+	cpu_renderer.render(camera.getCameraToWorldMatrix(), camera.getViewPos(), cpu_framebuffer);
+
+	int w = cpu_framebuffer.width;
+	int h = cpu_framebuffer.height;
+	gpu_timer.beginPass("upload");
+	glBindTexture(GL_TEXTURE_2D, cpu_frame_tex);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, w, h, 0, GL_RGB, GL_UNSIGNED_BYTE, cpu_framebuffer.pixels.data());
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, cpu_frame_fbo);
+	glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, cpu_frame_tex, 0);
+	bool scaled = w != window_width || h != window_height;
+	glBlitFramebuffer(0, 0, w, h, 0, 0, window_width, window_height,
+	                  GL_COLOR_BUFFER_BIT, scaled ? GL_LINEAR : GL_NEAREST);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+	gpu_timer.endPass("upload");
+}
+
+void displayWavefront(int render_width, int render_height)
+{
+	if (wavefront_renderer.getWidth() != render_width || wavefront_renderer.getHeight() != render_height) {
+		wavefront_renderer.setRenderSize(render_width, render_height);
+		progressive.reset();
+	}
+	camera_block.upload(camera, (GLfloat) render_width / (GLfloat) render_height,
+	                    progressive.getJitter(), render_width, render_height);
+	wavefront_renderer.setSampleCount(progressive.getSampleCount());
+	wavefront_renderer.render(&gpu_timer);
+	progressive.addSample();
 }
 
 void display()
 {
+	using Clock = std::chrono::steady_clock;
+
+	// Frames are traced at the dynamic resolution until the view has been
+	// idle for VIEW_IDLE_MS, the refinement of a static view at full
+	// resolution
+	int time_ms = glutGet(GLUT_ELAPSED_TIME);
+	if (view_changed) last_view_change_ms = time_ms;
+	view_changed = false;
+	bool interactive = time_ms - last_view_change_ms < VIEW_IDLE_MS;
+	int render_width = interactive ? dynamic_resolution.getRenderWidth() : window_width;
+	int render_height = interactive ? dynamic_resolution.getRenderHeight() : window_height;
+	Clock::time_point start = Clock::now();
+
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-	DrawModel(square_model, shader, "in_pos", NULL, NULL);
+	if (options.cpu) {
+		displayCpu(render_width, render_height);
+	} else if (options.wavefront) {
+		displayWavefront(render_width, render_height);
+	} else {
+		// Moving views are previewed once the variant has compiled
+		GLuint program = shader;
+		if (interactive && preview_variant >= 0) {
+			GLuint preview = shader_variants.getProgram(preview_variant);
+			if (preview != 0) program = preview;
+		}
+
+		progressive.setRenderSize(render_width, render_height);
+		camera_block.upload(camera, (GLfloat) window_width / (GLfloat) window_height,
+		                    progressive.getJitter(), render_width, render_height);
+		progressive.beginSample();
+		if (reprojecting) reprojection.beginFrame(program, interactive);
+		gpu_timer.beginPass("raytrace");
+		DrawModel(square_model, program, "in_pos", NULL, NULL);
+		gpu_timer.endPass("raytrace");
+		if (reprojecting) {
+			reprojection.endFrame(progressive.getFramebuffer(), render_width, render_height,
+			                      camera.getCameraToWorldMatrix(), camera.getViewPos(),
+			                      (GLfloat) window_width / (GLfloat) window_height);
+		}
+		progressive.endSample(0);
+
+		// Refine from full quality samples only
+		if (program != shader) progressive.reset();
+	}
+
+	if (interactive && dynamic_resolution.isEnabled()) {
+		glFinish();
+		double frame_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		dynamic_resolution.update(frame_ms, render_width, render_height);
+	}
 	glutSwapBuffers();
+	gpu_timer.endFrame();
+
+	// Follow a moving view with a full quality frame once it is idle, and
+	// keep refining a static view until it converges
+	if (interactive) {
+		if (!idle_check_pending) {
+			idle_check_pending = true;
+			glutTimerFunc(VIEW_IDLE_MS, &onViewIdle, 0);
+		}
+	} else if (!options.cpu && !progressive.isConverged()) {
+		glutPostRedisplay();
+	}
+
+	time_ms = glutGet(GLUT_ELAPSED_TIME);
+	if (options.gpu_timing && time_ms - last_timing_log_ms >= TIMING_LOG_INTERVAL_MS) {
+		gpu_timer.logStats(stdout);
+		gpu_timer.resetStats();
+		last_timing_log_ms = time_ms;
+	}
 }
 
 void reshape(GLsizei w, GLsizei h)
 {
+	window_width = w;
+	window_height = h;
+	dynamic_resolution.resize(w, h);
+	view_changed = true;
 	glViewport(0, 0, w, h);
-	GLfloat screen_ratio = (GLfloat) w / (GLfloat) h;
-	glUniform1f(uniformLoc(shader, "screen_ratio"), screen_ratio);
+	glutPostRedisplay();
+	if (options.cpu) {
+		return;
+	}
+	if (options.wavefront) {
+		wavefront_renderer.resize(w, h);
+		progressive.reset();
+		return;
+	}
+	progressive.resize(w, h);
+	if (reprojecting) {
+		reprojection.resize(w, h);
+		reprojection.attach(progressive.getFramebuffer());
+	}
 }
 
-void idle()
-{
-	//glutPostRedisplay();
+void keyboard(unsigned char key, int x, int y) {
+	// Held keys are polled by the camera on every update
+	startUpdates();
 }
 
 void mouse(int button, int state, int x, int y) {
+	if (button == GLUT_RIGHT_BUTTON || button == GLUT_MIDDLE_BUTTON) {
+		edit_button = state == GLUT_DOWN ? button : -1;
+		if (edit_button >= 0) editAt(x, y);
+		return;
+	}
 	camera.mouseClicked(button, state, x, y);
 }
 
 void motion(int x, int y) {
+	if (edit_button >= 0) {
+		editAt(x, y);
+		return;
+	}
 	camera.mouseDragged(x, y);
+	redrawIfChanged();
 }
 
 
@@ -119,16 +440,27 @@ void motion(int x, int y) {
 
 int main(int argc, char *argv[])
 {
+	options = parseOptions(argc, argv);
+	if (!options.shader_cache) {
+		setProgramCacheDir(NULL);
+	}
+	if (!options.bench.empty()) {
+		return runBenchmark(options);
+	}
+	if (options.headless) {
+		return runHeadless(options);
+	}
+
 	glutInit(&argc, argv);
 
 	glutInitDisplayMode(GLUT_RGBA | GLUT_DEPTH | GLUT_DOUBLE);
-	glutInitWindowSize(W, H);
+	glutInitWindowSize(options.width, options.height);
 
 	glutInitContextVersion(4, 6);
 	glutCreateWindow ("Ray Tracing");
 	glutDisplayFunc(display);
 	glutReshapeFunc(reshape);
-	glutIdleFunc(idle);
+	glutKeyboardFunc(keyboard);
 	glutMouseFunc(mouse);
 	glutMotionFunc(motion);
 
@@ -0,0 +1,49 @@
+#include "materials.hpp"
+
+#include <cassert>
+
+
+//----------------------Globals------------------------------------------------
+
+std::vector<MaterialProperties> materials = {
+	{vec3(0.0), 0.0, 0.0, 0.0, 1.0, 1.0}, // Void
+	{vec3(1.0), 0.2, 0.7, 0.3, 0.8, 1.5}, // Glass
+	{vec3(1.0), 0.6, 0.5, 0.2, 0.0, 1.0}, // Solid
+	{vec3(1.0), 0.5, 0.7, 0.3, 0.2, 1.5}  // Semi-solid
+};
+
+static GLuint material_buffer = 0;
+static size_t uploaded_count = 0; // Materials the buffer has room for
+
+
+//----------------------Implementation-----------------------------------------
+
+void uploadMaterials() {
+	if (material_buffer == 0) glGenBuffers(1, &material_buffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, material_buffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, materials.size() * sizeof(MaterialProperties),
+	             materials.data(), GL_DYNAMIC_DRAW);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MATERIALS_BINDING, material_buffer);
+	uploaded_count = materials.size();
+}
+
+void updateMaterial(int index, const MaterialProperties &material) {
+	assert(index >= 0 && index <= (int)materials.size() && index < MAX_MATERIAL_COUNT);
+	if (index == (int)materials.size()) {
+		materials.push_back(material);
+	} else {
+		materials[index] = material;
+	}
+
+	if (material_buffer == 0) {
+		// Sent with the rest on the first upload
+		return;
+	}
+	if ((size_t)index >= uploaded_count) {
+		uploadMaterials();
+		return;
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, material_buffer);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, index * sizeof(MaterialProperties),
+	                sizeof(MaterialProperties), &materials[index]);
+}
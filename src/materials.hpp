@@ -3,6 +3,24 @@
 
 #include "gl-import.hpp"
 
+#include "VectorUtils3.h"
+
+#include <vector>
+
+#define STD_VOID_INDEX 0
+
+// Voxel values are bytes, so this many materials at most
+#define MAX_MATERIAL_COUNT 256
+
+// Shader storage binding of the material table, see shaders/materials.glsl
+#define MATERIALS_BINDING 3
+
+// Reflection and refraction rays whose product of reflectivity and
+// refractivity along the path falls below this are not cast, unless chosen
+// with --min-ray-weight
+#define DEFAULT_MIN_RAY_WEIGHT 0.005
+
+// Built-in materials, the first entries of the default table
 enum class Material : GLubyte {
 	VOID = 0,
 	GLASS = 1,
@@ -10,4 +28,32 @@ enum class Material : GLubyte {
 	SEMI_SOLID = 3
 };
 
+// Laid out as the std430 Material struct in shaders/materials.glsl
+struct MaterialProperties {
+	vec3  color;
+	float diffusivity;
+	float specularity;
+	float reflectivity;
+	float refractivity;
+	float refraction_index;
+};
+static_assert(sizeof(MaterialProperties) == 32, "MaterialProperties must match std430 Material");
+
+// Material table indexed by voxel value, read by the CPU renderer and
+// uploaded to shaders. Starts with the built-in materials.
+extern std::vector<MaterialProperties> materials;
+
+/**
+ * Uploads the whole material table to a shader storage buffer bound to
+ * MATERIALS_BINDING.
+ */
+void uploadMaterials();
+
+/**
+ * Sets the specified material, appending it if just past the end of the
+ * table, and sends only that entry to the shader if the table fits in the
+ * uploaded buffer.
+ */
+void updateMaterial(int index, const MaterialProperties &material);
+
 #endif // MATERIALS_HPP
@@ -0,0 +1,47 @@
+#include "morton-grid.hpp"
+
+#include "materials.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+
+
+//----------------------Implementation-----------------------------------------
+
+/**
+ * Copies the voxels in [lo, hi] of the grid to the Morton grid, spread over
+ * all threads by layer of tiles, so that no two threads write the same cache
+ * line.
+ */
+static void copyVoxels(const VoxelGrid &grid, MortonGrid &morton, ivec3 lo, ivec3 hi) {
+	int first_layer = lo.z >> MORTON_TILE_SHIFT;
+	int last_layer = hi.z >> MORTON_TILE_SHIFT;
+	parallelFor(last_layer - first_layer + 1, [&](int layer) {
+		int z_lo = std::max((first_layer + layer) << MORTON_TILE_SHIFT, lo.z);
+		int z_hi = std::min(((first_layer + layer + 1) << MORTON_TILE_SHIFT) - 1, hi.z);
+		for (int z = z_lo; z <= z_hi; ++z) {
+			for (int y = lo.y; y <= hi.y; ++y) {
+				const GLubyte *row = &grid.voxels[grid.index(0, y, z)];
+				for (int x = lo.x; x <= hi.x; ++x) {
+					morton.at(x, y, z) = row[x];
+				}
+			}
+		}
+	});
+}
+
+MortonGrid::MortonGrid(const VoxelGrid &grid)
+	: size{grid.size}
+{
+	tile_count = ivec3((size.x + MORTON_TILE_SIZE - 1) >> MORTON_TILE_SHIFT,
+	                   (size.y + MORTON_TILE_SIZE - 1) >> MORTON_TILE_SHIFT,
+	                   (size.z + MORTON_TILE_SIZE - 1) >> MORTON_TILE_SHIFT);
+	voxels.assign((size_t)tile_count.x * tile_count.y * tile_count.z * MORTON_TILE_VOXELS, STD_VOID_INDEX);
+	if (size.x > 0 && size.y > 0 && size.z > 0) {
+		copyVoxels(grid, *this, ivec3(0), size - ivec3(1));
+	}
+}
+
+void MortonGrid::update(const VoxelGrid &grid, ivec3 lo, ivec3 hi) {
+	copyVoxels(grid, *this, lo, hi);
+}
@@ -0,0 +1,114 @@
+#ifndef MORTON_GRID_HPP
+#define MORTON_GRID_HPP
+
+#include "gl-import.hpp"
+#include "glsl-math.hpp"
+#include "voxel-grid.hpp"
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+#define MORTON_TILE_SHIFT  3
+#define MORTON_TILE_SIZE   (1 << MORTON_TILE_SHIFT) // Voxels per tile axis
+#define MORTON_TILE_VOXELS (MORTON_TILE_SIZE * MORTON_TILE_SIZE * MORTON_TILE_SIZE)
+#define MORTON_ALIGNMENT   64 // Bytes, of a cache line
+
+// Memory layout of the voxels traversed on the CPU, chosen with --layout
+enum class VoxelLayout {
+	LINEAR, // The VoxelGrid itself, stored as [z][y][x]
+	MORTON  // A MortonGrid copy of it
+};
+
+
+/**
+ * Returns the low 10 bits of a spread out to every third bit, from the
+ * lowest, so that spread x, y and z interleave when shifted by 0, 1 and 2.
+ * For unsigned ints or vectors of ints alike.
+ */
+template <typename T>
+constexpr inline __attribute__((always_inline))
+T mortonSpread(const T &a) {
+	T v = a & 0x3FF;
+	v = (v | (v << 16)) & 0x030000FF;
+	v = (v | (v << 8))  & 0x0300F00F;
+	v = (v | (v << 4))  & 0x030C30C3;
+	v = (v | (v << 2))  & 0x09249249;
+	return v;
+}
+
+
+/**
+ * Allocator of storage aligned to the specified number of bytes, e.g. to
+ * cache lines, beyond the 16 bytes of operator new.
+ */
+template <typename T, size_t Alignment>
+struct AlignedAllocator {
+	typedef T value_type;
+	template <typename U> struct rebind { typedef AlignedAllocator<U, Alignment> other; };
+
+	AlignedAllocator() {}
+	template <typename U> AlignedAllocator(const AlignedAllocator<U, Alignment> &) {}
+
+	T *allocate(size_t n) {
+		return static_cast<T *>(::operator new(n * sizeof(T), std::align_val_t(Alignment)));
+	}
+	void deallocate(T *p, size_t) {
+		::operator delete(p, std::align_val_t(Alignment));
+	}
+
+	template <typename U> bool operator==(const AlignedAllocator<U, Alignment> &) const { return true; }
+	template <typename U> bool operator!=(const AlignedAllocator<U, Alignment> &) const { return false; }
+};
+
+
+/**
+ * Voxel values stored in tiles of MORTON_TILE_SIZE^3 voxels along the
+ * Z-order curve, with the tiles stored as [z][y][x]. The voxels are aligned
+ * to MORTON_ALIGNMENT, so that every 64 byte cache line holds a 4^3 block,
+ * and neighbouring voxels along any axis mostly share cache lines, unlike
+ * in a VoxelGrid where every step along z touches a new one. Voxels beyond
+ * the grid size, in tiles on its far sides, are void.
+ *
+ * For CPU traversal only, the GPU reads the VoxelGrid it is copied from.
+ */
+struct MortonGrid {
+	ivec3 size;
+	ivec3 tile_count;
+	std::vector<GLubyte, AlignedAllocator<GLubyte, MORTON_ALIGNMENT>> voxels;
+
+	MortonGrid() : size{0}, tile_count{0} {}
+	explicit MortonGrid(const VoxelGrid &grid);
+
+	size_t index(int x, int y, int z) const {
+		const int mask = MORTON_TILE_SIZE - 1;
+		size_t tile = ((size_t)(z >> MORTON_TILE_SHIFT) * tile_count.y + (y >> MORTON_TILE_SHIFT)) * tile_count.x
+		            + (x >> MORTON_TILE_SHIFT);
+		return (tile << 3 * MORTON_TILE_SHIFT) | TILE_SPREAD[x & mask] | (TILE_SPREAD[y & mask] << 1) | (TILE_SPREAD[z & mask] << 2);
+	}
+
+	bool contains(ivec3 a) const {
+		return a.x >= 0 && a.y >= 0 && a.z >= 0
+		    && a.x < size.x && a.y < size.y && a.z < size.z;
+	}
+
+	GLubyte &at(int x, int y, int z) { return voxels[index(x, y, z)]; }
+	GLubyte at(int x, int y, int z) const { return voxels[index(x, y, z)]; }
+
+	/**
+	 * Copies the voxels in [lo, hi] of the specified grid, of the same size,
+	 * e.g. after they were edited.
+	 */
+	void update(const VoxelGrid &grid, ivec3 lo, ivec3 hi);
+
+private:
+	// mortonSpread of every coordinate within a tile, looked up as that is
+	// faster than spreading them in scalar code
+	static constexpr unsigned short TILE_SPREAD[MORTON_TILE_SIZE] = {
+		mortonSpread(0u), mortonSpread(1u), mortonSpread(2u), mortonSpread(3u),
+		mortonSpread(4u), mortonSpread(5u), mortonSpread(6u), mortonSpread(7u)
+	};
+	static_assert(MORTON_TILE_SIZE == 8, "TILE_SPREAD covers tiles of 8 voxels per axis");
+};
+
+#endif // MORTON_GRID_HPP
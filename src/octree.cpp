@@ -0,0 +1,192 @@
+#include "octree.hpp"
+
+#include "materials.hpp"
+#include "parallel.hpp"
+#include "shader-utils.hpp"
+
+#include <algorithm>
+
+
+//----------------------Constants----------------------------------------------
+
+#define MIXED -1
+
+#define BLOCK_NODES 8 // Children of a node
+
+
+//----------------------Implementation-----------------------------------------
+
+static int levelIndex(int size, int x, int y, int z) {
+	return (z * size + y) * size + x;
+}
+
+static GLuint leafNode(short value) {
+	return OCTREE_LEAF_BIT | (GLuint)value;
+}
+
+short Octree::nodeValue(const VoxelGrid &grid, int level, int x, int y, int z) const {
+	if (level > 0) {
+		return values[level][levelIndex(1 << (levels - level), x, y, z)];
+	}
+	if (x >= grid.size.x || y >= grid.size.y || z >= grid.size.z) {
+		// Padding up to the power of 2 root size
+		return STD_VOID_INDEX;
+	}
+	return grid.at(x, y, z);
+}
+
+/**
+ * Recomputes the values of the nodes of every level above the voxels in
+ * [lo, hi], bottom-up.
+ */
+void Octree::collapse(const VoxelGrid &grid, ivec3 lo, ivec3 hi) {
+	for (int level = 1; level <= levels; ++level) {
+		int level_size = 1 << (levels - level);
+		ivec3 level_lo = ivec3(lo.x >> level, lo.y >> level, lo.z >> level);
+		ivec3 level_hi = ivec3(hi.x >> level, hi.y >> level, hi.z >> level);
+		parallelFor(level_hi.z - level_lo.z + 1, [&](int layer) {
+			int z = level_lo.z + layer;
+			for (int y = level_lo.y; y <= level_hi.y; ++y) {
+				for (int x = level_lo.x; x <= level_hi.x; ++x) {
+					short value = nodeValue(grid, level - 1, 2 * x, 2 * y, 2 * z);
+					for (int i = 1; i < 8 && value != MIXED; ++i) {
+						short child = nodeValue(grid, level - 1,
+							2 * x + (i & 1), 2 * y + ((i >> 1) & 1), 2 * z + ((i >> 2) & 1));
+						if (child != value) value = MIXED;
+					}
+					values[level][levelIndex(level_size, x, y, z)] = value;
+				}
+			}
+		});
+	}
+}
+
+GLuint Octree::allocateBlock() {
+	if (!free_blocks.empty()) {
+		GLuint block = free_blocks.back();
+		free_blocks.pop_back();
+		return block;
+	}
+	nodes.resize(nodes.size() + BLOCK_NODES);
+	return nodes.size() - BLOCK_NODES;
+}
+
+/**
+ * Releases the blocks of every descendant of the node at node_i.
+ */
+void Octree::freeChildren(GLuint node_i) {
+	GLuint node = nodes[node_i];
+	if (node & OCTREE_LEAF_BIT) return;
+	for (int i = 0; i < 8; ++i) {
+		freeChildren(node + i);
+	}
+	free_blocks.push_back(node);
+}
+
+/**
+ * Sets the node at node_i, which spans the node at (x, y, z) of the
+ * specified level, and adds its subtree anew.
+ */
+void Octree::buildNode(const VoxelGrid &grid, GLuint node_i, int level, int x, int y, int z) {
+	short value = nodeValue(grid, level, x, y, z);
+	if (value != MIXED) {
+		nodes[node_i] = leafNode(value);
+		return;
+	}
+	GLuint first_child = allocateBlock();
+	nodes[node_i] = first_child;
+	markDirty(first_child);
+	for (int i = 0; i < 8; ++i) {
+		buildNode(grid, first_child + i, level - 1,
+		          2 * x + (i & 1), 2 * y + ((i >> 1) & 1), 2 * z + ((i >> 2) & 1));
+	}
+}
+
+/**
+ * Brings the node at node_i, which spans the node at (x, y, z) of the
+ * specified level, and its subtree up to date with the values over the
+ * voxels in [lo, hi]. Subtrees outside of them are left as they are.
+ */
+void Octree::updateNode(const VoxelGrid &grid, GLuint node_i, int level, int x, int y, int z,
+                        ivec3 lo, ivec3 hi)
+{
+	if ((x << level) > hi.x || ((x + 1) << level) <= lo.x
+	 || (y << level) > hi.y || ((y + 1) << level) <= lo.y
+	 || (z << level) > hi.z || ((z + 1) << level) <= lo.z) {
+		return;
+	}
+	short value = nodeValue(grid, level, x, y, z);
+	GLuint node = nodes[node_i];
+	if (value != MIXED && node == leafNode(value)) return;
+	if (value != MIXED || (node & OCTREE_LEAF_BIT)) {
+		// Changed shape, or collapsed to another value
+		freeChildren(node_i);
+		buildNode(grid, node_i, level, x, y, z);
+		markDirty(node_i);
+		return;
+	}
+	for (int i = 0; i < 8; ++i) {
+		updateNode(grid, node + i, level - 1,
+		           2 * x + (i & 1), 2 * y + ((i >> 1) & 1), 2 * z + ((i >> 2) & 1), lo, hi);
+	}
+}
+
+void Octree::markDirty(GLuint node_i) {
+	if (buffer != 0) dirty_blocks.push_back(node_i & ~(GLuint)(BLOCK_NODES - 1));
+}
+
+int Octree::levelsFor(ivec3 grid_size) {
+	int max_size = std::max(std::max(grid_size.x, grid_size.y), grid_size.z);
+	int levels = 0;
+	while ((1 << levels) < max_size) ++levels;
+	return levels;
+}
+
+Octree::Octree(const VoxelGrid &grid) : buffer{0}, uploaded_capacity{0} {
+	levels = levelsFor(grid.size);
+	int size = 1 << levels;
+
+	// Collapse uniform regions bottom-up
+	values.resize(levels + 1);
+	for (int level = 1; level <= levels; ++level) {
+		int level_size = size >> level;
+		values[level].resize(level_size * level_size * level_size);
+	}
+	collapse(grid, ivec3(0), ivec3(size - 1));
+
+	// Store nodes top-down, with the root at index 0
+	nodes.assign(BLOCK_NODES, 0);
+	buildNode(grid, 0, levels, 0, 0, 0);
+}
+
+void Octree::update(const VoxelGrid &grid, ivec3 lo, ivec3 hi) {
+	collapse(grid, lo, hi);
+	updateNode(grid, 0, levels, 0, 0, 0, lo, hi);
+}
+
+void Octree::upload(GLuint shader) {
+	if (buffer == 0) glGenBuffers(1, &buffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+	if (nodes.size() > uploaded_capacity) {
+		// Room for growth, so that adding blocks rarely reallocates
+		uploaded_capacity = nodes.size() + nodes.size() / 2;
+		glBufferData(GL_SHADER_STORAGE_BUFFER, uploaded_capacity * sizeof(GLuint), NULL, GL_DYNAMIC_DRAW);
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, nodes.size() * sizeof(GLuint), nodes.data());
+	} else {
+		// Runs of consecutive blocks sent at once
+		std::sort(dirty_blocks.begin(), dirty_blocks.end());
+		dirty_blocks.erase(std::unique(dirty_blocks.begin(), dirty_blocks.end()), dirty_blocks.end());
+		for (size_t i = 0; i < dirty_blocks.size(); ) {
+			size_t end = i + 1;
+			while (end < dirty_blocks.size() && dirty_blocks[end] == dirty_blocks[end - 1] + BLOCK_NODES) ++end;
+			glBufferSubData(GL_SHADER_STORAGE_BUFFER, dirty_blocks[i] * sizeof(GLuint),
+			                (end - i) * BLOCK_NODES * sizeof(GLuint), &nodes[dirty_blocks[i]]);
+			i = end;
+		}
+	}
+	dirty_blocks.clear();
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, OCTREE_BINDING, buffer);
+
+	glUseProgram(shader);
+	glUniform1i(uniformLoc(shader, "octree_levels"), levels);
+}
@@ -0,0 +1,80 @@
+#ifndef OCTREE_HPP
+#define OCTREE_HPP
+
+#include "gl-import.hpp"
+#include "voxel-grid.hpp"
+
+#include <vector>
+
+// Shader storage binding of the node buffer, see shaders/octree.glsl
+#define OCTREE_BINDING 0
+
+// Node flag for uniform nodes, which hold their voxel value in the low byte.
+// Other nodes hold the index of the first of their 8 children, which are
+// stored consecutively in x + 2y + 4z order.
+#define OCTREE_LEAF_BIT 0x80000000u
+
+
+/**
+ * Sparse voxel octree, where every uniform region is collapsed into a single
+ * leaf node. The root spans the grid padded with void to a power of 2 cube.
+ *
+ * The 8 children of a node are stored as a block, at a multiple of 8 nodes,
+ * with the root alone in the first block. Blocks of subtrees that collapse
+ * are reused by the next subtrees added, so that an update rewrites only the
+ * blocks of the subtrees it changes and leaves the rest in place.
+ */
+class Octree {
+
+public:
+	Octree() : levels{0}, buffer{0}, uploaded_capacity{0} {}
+	Octree(const VoxelGrid &grid);
+
+	/**
+	 * Returns the levels of the octree over a grid of the specified size.
+	 */
+	static int levelsFor(ivec3 grid_size);
+
+	/**
+	 * Updates the nodes over the voxels in [lo, hi] of the specified grid,
+	 * of the same size, e.g. after they were edited.
+	 */
+	void update(const VoxelGrid &grid, ivec3 lo, ivec3 hi);
+
+	const std::vector<GLuint> &getNodes() const { return nodes; }
+	int getLevels() const { return levels; }
+
+	/**
+	 * Uploads the nodes to a shader storage buffer and sets the octree
+	 * uniforms of the specified program. After the first call, only the
+	 * blocks changed since the last call are sent, unless the nodes have
+	 * outgrown the buffer.
+	 */
+	void upload(GLuint shader);
+
+private:
+	// Value of every node per level, -1 if not uniform. Level 0 is read
+	// directly from the grid and left empty.
+	typedef std::vector<std::vector<short>> LevelValues;
+
+	short nodeValue(const VoxelGrid &grid, int level, int x, int y, int z) const;
+	void collapse(const VoxelGrid &grid, ivec3 lo, ivec3 hi);
+	GLuint allocateBlock();
+	void freeChildren(GLuint node_i);
+	void buildNode(const VoxelGrid &grid, GLuint node_i, int level, int x, int y, int z);
+	void updateNode(const VoxelGrid &grid, GLuint node_i, int level, int x, int y, int z, ivec3 lo, ivec3 hi);
+	void markDirty(GLuint node_i);
+
+	int levels;   // The root spans 2^levels voxels per axis
+	LevelValues values;
+	std::vector<GLuint> nodes;
+	std::vector<GLuint> free_blocks; // Indices of unused blocks
+
+	// Blocks changed and not yet uploaded, tracked after the first upload
+	std::vector<GLuint> dirty_blocks;
+
+	GLuint buffer;
+	size_t uploaded_capacity; // Nodes allocated on the GPU
+};
+
+#endif // OCTREE_HPP
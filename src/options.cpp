@@ -0,0 +1,172 @@
+#include "options.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+
+static void printUsage(const char *program) {
+	printf("Usage: %s [options]\n"
+	       "  --cpu                Render on the CPU\n"
+	       "  --wavefront          Render with compute shaders and ray queues\n"
+	       "  --headless           Render offscreen without a window\n"
+	       "  --frames N           Frames to render in headless mode (default 1)\n"
+	       "  --size WxH           Frame size (default 512x512)\n"
+	       "  --camera X,Y[,ZOOM]  Camera rotation around the y and sideways axes, and zoom\n"
+	       "  --orbit RADIANS      Camera rotation per headless frame\n"
+	       "  --output PREFIX      Save headless frames as PREFIX-NNNN.tga\n"
+	       "  --structure NAME     Voxel storage: grid, octree, distance or brickmap\n"
+	       "                       (default grid, the CPU uses grid or brickmap)\n"
+	       "  --layout NAME        Memory layout of the grid for CPU traversal and light baking:\n"
+	       "                       linear or morton (default linear)\n"
+	       "  --grid N|XxYxZ       Voxels per axis (default 16)\n"
+	       "  --scene NAME         Generated scene: test, shapes, terrain or caves (default test)\n"
+	       "  --seed N             Seed of the noise of generated scenes (default 1)\n"
+	       "  --heightmap FILE     Raise terrain from a binary PGM height map instead of the scene\n"
+	       "  --model FILE         Voxelize an OBJ model instead of the scene\n"
+	       "  --solid              Fill the interior of the voxelized model\n"
+	       "  --min-ray-weight W   Skip recursive rays contributing less than W (default 0.005)\n"
+	       "  --baked-shadows      Bake light visibility per cell instead of marching shadow rays\n"
+	       "  --samples N          Jittered samples per pixel to refine a static view with on the GPU\n"
+	       "                       (default 64 in a window, 1 headless)\n"
+	       "  --reprojection on|off\n"
+	       "                       Reuse direct light of the last frame where a moving view sees the\n"
+	       "                       same voxels, fragment shader only (default on in a window, off\n"
+	       "                       headless)\n"
+	       "  --preview-depth N    Reflection and refraction depth of moving views in a window with the\n"
+	       "                       fragment shader, -1 for the full depth (default 1)\n"
+	       "  --frame-budget MS    Trace moving views in a window at a lower resolution to stay\n"
+	       "                       within MS per frame, 0 disables (default 16)\n"
+	       "  --gpu-timing         Log the GPU time of every render pass\n"
+	       "  --no-shader-cache    Compile every program instead of loading binaries from shaders/cache\n"
+	       "  --bench FILE         Run the benchmark suite offscreen, writing results as JSON\n",
+	       program);
+}
+
+static const char *nextArg(int argc, char *argv[], int &i) {
+	if (i + 1 >= argc) {
+		fprintf(stderr, "Missing value for %s\n", argv[i]);
+		printUsage(argv[0]);
+		exit(1);
+	}
+	return argv[++i];
+}
+
+static void badValue(char *argv[], int i) {
+	fprintf(stderr, "Bad value for %s: %s\n", argv[i - 1], argv[i]);
+	printUsage(argv[0]);
+	exit(1);
+}
+
+Options parseOptions(int argc, char *argv[]) {
+	Options options;
+	for (int i = 1; i < argc; ++i) {
+		const char *arg = argv[i];
+		if (strcmp(arg, "--cpu") == 0) {
+			options.cpu = true;
+		} else if (strcmp(arg, "--wavefront") == 0) {
+			options.wavefront = true;
+		} else if (strcmp(arg, "--headless") == 0) {
+			options.headless = true;
+		} else if (strcmp(arg, "--frames") == 0) {
+			options.frames = atoi(nextArg(argc, argv, i));
+			if (options.frames < 1) badValue(argv, i);
+		} else if (strcmp(arg, "--size") == 0) {
+			if (sscanf(nextArg(argc, argv, i), "%dx%d", &options.width, &options.height) != 2
+			 || options.width < 1 || options.height < 1) badValue(argv, i);
+		} else if (strcmp(arg, "--camera") == 0) {
+			if (sscanf(nextArg(argc, argv, i), "%f,%f,%f", &options.camera_x, &options.camera_y, &options.camera_zoom) < 2)
+				badValue(argv, i);
+		} else if (strcmp(arg, "--orbit") == 0) {
+			options.orbit_step = atof(nextArg(argc, argv, i));
+		} else if (strcmp(arg, "--output") == 0) {
+			options.output = nextArg(argc, argv, i);
+		} else if (strcmp(arg, "--structure") == 0) {
+			const char *name = nextArg(argc, argv, i);
+			if (strcmp(name, "grid") == 0) {
+				options.structure = VoxelStructure::GRID;
+			} else if (strcmp(name, "octree") == 0) {
+				options.structure = VoxelStructure::OCTREE;
+			} else if (strcmp(name, "distance") == 0) {
+				options.structure = VoxelStructure::DISTANCE_FIELD;
+			} else if (strcmp(name, "brickmap") == 0) {
+				options.structure = VoxelStructure::BRICKMAP;
+			} else {
+				badValue(argv, i);
+			}
+		} else if (strcmp(arg, "--layout") == 0) {
+			const char *name = nextArg(argc, argv, i);
+			if (strcmp(name, "linear") == 0) {
+				options.layout = VoxelLayout::LINEAR;
+			} else if (strcmp(name, "morton") == 0) {
+				options.layout = VoxelLayout::MORTON;
+			} else {
+				badValue(argv, i);
+			}
+		} else if (strcmp(arg, "--grid") == 0) {
+			const char *size = nextArg(argc, argv, i);
+			ivec3 &g = options.grid_size;
+			int n = sscanf(size, "%dx%dx%d", &g.x, &g.y, &g.z);
+			if (n == 1) g = ivec3(g.x);
+			if ((n != 1 && n != 3) || g.x < 1 || g.y < 1 || g.z < 1) badValue(argv, i);
+		} else if (strcmp(arg, "--scene") == 0) {
+			const char *name = nextArg(argc, argv, i);
+			if (strcmp(name, "test") == 0) {
+				options.scene = GeneratedScene::TEST;
+			} else if (strcmp(name, "shapes") == 0) {
+				options.scene = GeneratedScene::SHAPES;
+			} else if (strcmp(name, "terrain") == 0) {
+				options.scene = GeneratedScene::TERRAIN;
+			} else if (strcmp(name, "caves") == 0) {
+				options.scene = GeneratedScene::CAVES;
+			} else {
+				badValue(argv, i);
+			}
+		} else if (strcmp(arg, "--seed") == 0) {
+			options.seed = strtoul(nextArg(argc, argv, i), NULL, 10);
+		} else if (strcmp(arg, "--heightmap") == 0) {
+			options.heightmap = nextArg(argc, argv, i);
+		} else if (strcmp(arg, "--model") == 0) {
+			options.model = nextArg(argc, argv, i);
+		} else if (strcmp(arg, "--solid") == 0) {
+			options.solid = true;
+		} else if (strcmp(arg, "--min-ray-weight") == 0) {
+			options.min_ray_weight = atof(nextArg(argc, argv, i));
+			if (options.min_ray_weight < 0.0) badValue(argv, i);
+		} else if (strcmp(arg, "--baked-shadows") == 0) {
+			options.baked_shadows = true;
+		} else if (strcmp(arg, "--samples") == 0) {
+			options.samples = atoi(nextArg(argc, argv, i));
+			if (options.samples < 1) badValue(argv, i);
+		} else if (strcmp(arg, "--reprojection") == 0) {
+			const char *value = nextArg(argc, argv, i);
+			if (strcmp(value, "on") == 0) {
+				options.reprojection = 1;
+			} else if (strcmp(value, "off") == 0) {
+				options.reprojection = 0;
+			} else {
+				badValue(argv, i);
+			}
+		} else if (strcmp(arg, "--preview-depth") == 0) {
+			options.preview_depth = atoi(nextArg(argc, argv, i));
+			if (options.preview_depth < -1) badValue(argv, i);
+		} else if (strcmp(arg, "--frame-budget") == 0) {
+			options.frame_budget_ms = atof(nextArg(argc, argv, i));
+			if (options.frame_budget_ms < 0.0) badValue(argv, i);
+		} else if (strcmp(arg, "--gpu-timing") == 0) {
+			options.gpu_timing = true;
+		} else if (strcmp(arg, "--no-shader-cache") == 0) {
+			options.shader_cache = false;
+		} else if (strcmp(arg, "--bench") == 0) {
+			options.bench = nextArg(argc, argv, i);
+		} else if (strcmp(arg, "--help") == 0) {
+			printUsage(argv[0]);
+			exit(0);
+		} else {
+			fprintf(stderr, "Unknown option %s\n", arg);
+			printUsage(argv[0]);
+			exit(1);
+		}
+	}
+	return options;
+}
@@ -0,0 +1,52 @@
+#ifndef OPTIONS_HPP
+#define OPTIONS_HPP
+
+#include "dynamic-resolution.hpp"
+#include "generators.hpp"
+#include "materials.hpp"
+#include "morton-grid.hpp"
+#include "shader-variants.hpp"
+#include "voxel-generator.hpp"
+
+#include <cmath>
+#include <string>
+
+
+// Command line options
+struct Options {
+	bool cpu = false;       // Render on the CPU instead of the fragment shader
+	bool wavefront = false; // Render with compute shaders instead of the fragment shader
+	bool headless = false;  // Render offscreen without opening a window
+	int frames = 1;         // Number of frames to render in headless mode
+	int width = 512;
+	int height = 512;
+	float camera_x = 0.2 * M_PI;
+	float camera_y = -0.125 * M_PI;
+	float camera_zoom = -1.0; // Negative for the default zoom
+	float orbit_step = 0.0;   // Camera rotation per headless frame, in radians
+	std::string output;       // Headless output file prefix, nothing saved if empty
+	VoxelStructure structure = VoxelStructure::GRID;
+	VoxelLayout layout = VoxelLayout::LINEAR; // Of the grid traversed on the CPU
+	ivec3 grid_size = ivec3(DEFAULT_VOXEL_COUNT); // Voxels per axis
+	GeneratedScene scene = GeneratedScene::TEST;
+	unsigned seed = 1;        // Of the noise of generated scenes
+	std::string heightmap;    // PGM file to raise terrain from instead of the generated scene
+	std::string model;        // OBJ file to voxelize instead of the generated scene
+	bool solid = false;       // Fill the interior of the voxelized model
+	float min_ray_weight = DEFAULT_MIN_RAY_WEIGHT; // 0 casts every recursive ray
+	bool baked_shadows = false; // Look up shadows in a baked light volume
+	int samples = 0;          // Samples per pixel of a static view, 0 for PROGRESSIVE_SAMPLES in a window or 1 headless
+	int reprojection = -1;    // Reuse direct light of the last frame while moving: 1 on, 0 off, -1 for on in a window and off headless
+	int preview_depth = DEFAULT_PREVIEW_DEPTH; // Ray depth of moving views in a window, -1 for the full depth
+	double frame_budget_ms = DEFAULT_FRAME_BUDGET_MS; // Lowers the resolution of moving views in a window, 0 disables
+	bool gpu_timing = false;  // Log the GPU time of every render pass
+	bool shader_cache = true; // Load linked programs from shaders/cache when unchanged
+	std::string bench;        // Benchmark results file, runs the benchmark suite if set
+};
+
+/**
+ * Parses the specified command line. Prints usage and exits on bad input.
+ */
+Options parseOptions(int argc, char *argv[]);
+
+#endif // OPTIONS_HPP
@@ -0,0 +1,36 @@
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+
+int threadCount() {
+	static const int count = std::max(1u, std::thread::hardware_concurrency());
+	return count;
+}
+
+void parallelFor(int count, const std::function<void(int)> &body) {
+	int thread_count = std::min(threadCount(), count);
+	if (thread_count <= 1) {
+		for (int i = 0; i < count; ++i) body(i);
+		return;
+	}
+
+	std::atomic<int> next{0};
+	auto work = [&]() {
+		for (int i = next++; i < count; i = next++) {
+			body(i);
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (int t = 1; t < thread_count; ++t) {
+		threads.emplace_back(work);
+	}
+	work();
+	for (std::thread &thread : threads) {
+		thread.join();
+	}
+}
@@ -0,0 +1,19 @@
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+#include <functional>
+
+
+/**
+ * Returns the number of worker threads used by parallelFor.
+ */
+int threadCount();
+
+/**
+ * Calls body(i) for every i in [0, count), spread over all hardware threads.
+ * Indices are handed out dynamically, so uneven work per index is fine.
+ * Returns when every call has finished.
+ */
+void parallelFor(int count, const std::function<void(int)> &body);
+
+#endif // PARALLEL_HPP
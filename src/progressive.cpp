@@ -0,0 +1,68 @@
+#include "progressive.hpp"
+
+#include <cstdlib>
+
+
+//----------------------Implementation-----------------------------------------
+
+// Radical inverse of index in the specified base, in [0, 1)
+static float halton(int index, int base) {
+	float result = 0.0;
+	float fraction = 1.0;
+	while (index > 0) {
+		fraction /= base;
+		result += fraction * (index % base);
+		index /= base;
+	}
+	return result;
+}
+
+vec2 Progressive::getJitter() const {
+	if (sample_count == 0) {
+		return vec2(0.0, 0.0);
+	}
+	return vec2(halton(sample_count, 2) - 0.5, halton(sample_count, 3) - 0.5);
+}
+
+void Progressive::resize(int width, int height) {
+	if (fbo != NULL) {
+		glDeleteFramebuffers(1, &fbo->fb);
+		glDeleteTextures(1, &fbo->texid);
+		glDeleteRenderbuffers(1, &fbo->rb);
+		free(fbo);
+	}
+	fbo = initFBO(width, height, 0);
+	render_width = width;
+	render_height = height;
+	sample_count = 0;
+}
+
+void Progressive::setRenderSize(int width, int height) {
+	if (width == render_width && height == render_height) return;
+	render_width = width;
+	render_height = height;
+	sample_count = 0;
+}
+
+void Progressive::beginSample() {
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo->fb);
+	glViewport(0, 0, render_width, render_height);
+	glClear(GL_DEPTH_BUFFER_BIT);
+
+	// mean = weight * sample + (1 - weight) * mean
+	glEnable(GL_BLEND);
+	glBlendColor(0.0, 0.0, 0.0, getBlendWeight());
+	glBlendFunc(GL_CONSTANT_ALPHA, GL_ONE_MINUS_CONSTANT_ALPHA);
+}
+
+void Progressive::endSample(GLuint target_fbo) {
+	glDisable(GL_BLEND);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo->fb);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, target_fbo);
+	bool scaled = render_width != fbo->width || render_height != fbo->height;
+	glBlitFramebuffer(0, 0, render_width, render_height, 0, 0, fbo->width, fbo->height,
+	                  GL_COLOR_BUFFER_BIT, scaled ? GL_LINEAR : GL_NEAREST);
+	glBindFramebuffer(GL_FRAMEBUFFER, target_fbo);
+	glViewport(0, 0, fbo->width, fbo->height);
+	++sample_count;
+}
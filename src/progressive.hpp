@@ -0,0 +1,85 @@
+#ifndef PROGRESSIVE_HPP
+#define PROGRESSIVE_HPP
+
+#include "gl-import.hpp"
+#include "glsl-math.hpp"
+
+#include "GL_utilities.h"
+
+// Samples per pixel a static view converges to in a window, unless chosen
+// with --samples
+#define PROGRESSIVE_SAMPLES 64
+
+
+/**
+ * Progressive rendering of a static view: every frame renders one sample per
+ * pixel, jittered within the pixel, and the running mean of the samples is
+ * kept in a float framebuffer until max samples are reached. Any change to
+ * the view restarts from a single centered sample, which is the plain
+ * unjittered frame.
+ */
+class Progressive {
+
+public:
+	Progressive() : fbo{NULL}, render_width{0}, render_height{0}, sample_count{0}, max_samples{1} {}
+
+	void setMaxSamples(int samples) { max_samples = samples; }
+
+	// Starts over from the first sample, on any change to the view
+	void reset() { sample_count = 0; }
+
+	int getSampleCount() const { return sample_count; }
+	bool isConverged() const { return sample_count >= max_samples; }
+
+	/**
+	 * Returns the sub-pixel offset of the next sample from the pixel center,
+	 * in pixels. The first sample is centered, the rest follow the Halton
+	 * sequence in bases 2 and 3 to cover the pixel evenly.
+	 */
+	vec2 getJitter() const;
+
+	// Weight of the next sample in the running mean
+	float getBlendWeight() const { return 1.0 / (sample_count + 1); }
+
+	/**
+	 * Recreates the float framebuffer for the specified frame size, also
+	 * rendered at, and starts over.
+	 */
+	void resize(int width, int height);
+
+	/**
+	 * Renders samples at the specified size, at most the frame size, to be
+	 * upscaled to the frame. Starts over if the size changed.
+	 */
+	void setRenderSize(int width, int height);
+
+	/**
+	 * Binds the float framebuffer for drawing at the render size, with
+	 * blending set up to add the next sample to the running mean. The
+	 * sample is jittered by getJitter through the camera block.
+	 */
+	void beginSample();
+
+	/**
+	 * Restores blending and the viewport, blits the mean to the specified
+	 * framebuffer, bilinearly upscaled to the frame size, and counts the
+	 * sample.
+	 */
+	void endSample(GLuint target_fbo);
+
+	// Float framebuffer holding the mean at attachment 0
+	GLuint getFramebuffer() const { return fbo->fb; }
+
+	/**
+	 * Counts a sample accumulated by the renderer itself.
+	 */
+	void addSample() { ++sample_count; }
+
+private:
+	FBOstruct *fbo; // Running mean, RGBA32F
+	int render_width, render_height;
+	int sample_count;
+	int max_samples;
+};
+
+#endif // PROGRESSIVE_HPP
@@ -0,0 +1,95 @@
+#include "reprojection.hpp"
+
+#include "shader-utils.hpp"
+
+#include "GL_utilities.h"
+
+
+//----------------------Implementation-----------------------------------------
+
+static void initTexture(GLuint texture, GLint internal_format, int width, int height) {
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, internal_format, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+}
+
+void Reprojection::resize(int width, int height) {
+	if (hit_tex == 0) {
+		glGenTextures(1, &hit_tex);
+		glGenTextures(1, &direct_tex);
+		glGenTextures(1, &history_direct_tex);
+		glGenTextures(1, &history_hit_tex);
+		glGenFramebuffers(1, &history_fbo);
+	}
+	this->width = width;
+	this->height = height;
+	// Direct light may exceed 1 before adding the reflections and ambient
+	// light and clamping
+	initTexture(hit_tex, GL_RGBA32F, width, height);
+	initTexture(direct_tex, GL_RGBA16F, width, height);
+	initTexture(history_direct_tex, GL_RGBA16F, width, height);
+	initTexture(history_hit_tex, GL_RGBA32F, width, height);
+
+	GLint draw_fbo = 0;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &draw_fbo);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, history_fbo);
+	glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, HIT_ATTACHMENT, GL_TEXTURE_2D, history_hit_tex, 0);
+	glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, DIRECT_ATTACHMENT, GL_TEXTURE_2D, history_direct_tex, 0);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, draw_fbo);
+
+	has_history = false;
+	printError("resize reprojection");
+}
+
+void Reprojection::attach(GLuint fbo) {
+	GLint draw_fbo = 0;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &draw_fbo);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbo);
+	glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, HIT_ATTACHMENT, GL_TEXTURE_2D, hit_tex, 0);
+	glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, DIRECT_ATTACHMENT, GL_TEXTURE_2D, direct_tex, 0);
+	const GLenum draw_buffers[] = {GL_COLOR_ATTACHMENT0, HIT_ATTACHMENT, DIRECT_ATTACHMENT};
+	glDrawBuffers(3, draw_buffers);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, draw_fbo);
+}
+
+void Reprojection::beginFrame(GLuint shader, bool reuse) {
+	glDisablei(GL_BLEND, 1);
+	glDisablei(GL_BLEND, 2);
+
+	glUseProgram(shader);
+	glUniform1i(uniformLoc(shader, "temporal_reuse"), reuse && has_history);
+	if (!has_history) return;
+
+	glActiveTexture(GL_TEXTURE0 + HISTORY_DIRECT_TEXTURE_UNIT);
+	glBindTexture(GL_TEXTURE_2D, history_direct_tex);
+	glActiveTexture(GL_TEXTURE0 + HISTORY_HIT_TEXTURE_UNIT);
+	glBindTexture(GL_TEXTURE_2D, history_hit_tex);
+	glActiveTexture(GL_TEXTURE0);
+	glUniformMatrix4fv(uniformLoc(shader, "prev_world_to_camera"), 1, GL_TRUE, prev_world_to_camera.m);
+	glUniform3fv(uniformLoc(shader, "prev_view_pos"), 1, (GLfloat *)&prev_view_pos);
+	glUniform1f(uniformLoc(shader, "prev_screen_ratio"), prev_screen_ratio);
+	glUniform2i(uniformLoc(shader, "prev_render_size"), prev_render_width, prev_render_height);
+}
+
+void Reprojection::endFrame(GLuint fbo, int render_width, int render_height,
+                            const mat4 &camera_to_world_matrix, vec3 view_pos, float screen_ratio) {
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, history_fbo);
+	const GLenum attachments[] = {HIT_ATTACHMENT, DIRECT_ATTACHMENT};
+	for (GLenum attachment : attachments) {
+		glReadBuffer(attachment);
+		glDrawBuffer(attachment);
+		glBlitFramebuffer(0, 0, render_width, render_height, 0, 0, render_width, render_height,
+		                  GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	}
+	glReadBuffer(GL_COLOR_ATTACHMENT0);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+
+	has_history = true;
+	prev_render_width = render_width;
+	prev_render_height = render_height;
+	prev_world_to_camera = InvertMat4(camera_to_world_matrix);
+	prev_view_pos = view_pos;
+	prev_screen_ratio = screen_ratio;
+}
@@ -0,0 +1,86 @@
+#ifndef REPROJECTION_HPP
+#define REPROJECTION_HPP
+
+#include "gl-import.hpp"
+
+#include "VectorUtils3.h"
+
+// Texture units of history_direct_tex and history_hit_tex, must match
+// shaders/reprojection.glsl
+#define HISTORY_DIRECT_TEXTURE_UNIT 3
+#define HISTORY_HIT_TEXTURE_UNIT    4
+
+// Draw buffers of the fragment shader outputs out_hit and out_direct
+#define HIT_ATTACHMENT    GL_COLOR_ATTACHMENT1
+#define DIRECT_ATTACHMENT GL_COLOR_ATTACHMENT2
+
+
+/**
+ * Temporal reprojection for shaders/raytracing.frag: the primary hits of
+ * every frame and the direct light at them are kept as history, and the next
+ * frame reuses the direct light of any pixel whose primary hit projects onto
+ * a pixel of the last frame that saw the same voxel face. That skips the
+ * shadow rays of the primary hit, while its reflection and refraction rays,
+ * which change with the viewpoint, are traced in full.
+ *
+ * Reused light lags the specular highlights, so reuse is meant for frames of
+ * a moving view, followed by fully traced ones once it stops. Direct light is
+ * shaded again after REPROJECTION_MAX_AGE frames of reuse, see
+ * shaders/reprojection.glsl.
+ */
+class Reprojection {
+
+public:
+	Reprojection()
+		: hit_tex{0}, direct_tex{0}, history_fbo{0}, history_direct_tex{0}, history_hit_tex{0},
+		  width{0}, height{0}, has_history{false},
+		  prev_render_width{0}, prev_render_height{0}, prev_screen_ratio{1.0} {}
+
+	/**
+	 * Recreates the textures for the specified frame size, dropping the
+	 * history.
+	 */
+	void resize(int width, int height);
+
+	/**
+	 * Attaches the primary hit and direct light outputs to the specified
+	 * framebuffer, which holds the frame colors at attachment 0.
+	 */
+	void attach(GLuint fbo);
+
+	// Drops the history, e.g. when the voxels change
+	void invalidate() { has_history = false; }
+
+	/**
+	 * Binds the history to the specified program and enables reuse in the
+	 * frame drawn next if requested and there is history. Call after
+	 * blending is set up, as the hit and direct light outputs are never
+	 * blended.
+	 */
+	void beginFrame(GLuint shader, bool reuse);
+
+	/**
+	 * Copies the primary hits and direct light of the frame just drawn to the
+	 * specified framebuffer, as passed to attach, into the history, along with
+	 * the camera it was drawn from.
+	 */
+	void endFrame(GLuint fbo, int render_width, int render_height,
+	              const mat4 &camera_to_world_matrix, vec3 view_pos, float screen_ratio);
+
+private:
+	GLuint hit_tex;    // Primary hits of the frame being drawn
+	GLuint direct_tex; // Direct light at them
+	GLuint history_fbo;
+	GLuint history_direct_tex;
+	GLuint history_hit_tex;
+	int width, height;
+
+	// Last frame
+	bool has_history;
+	int prev_render_width, prev_render_height;
+	mat4 prev_world_to_camera;
+	vec3 prev_view_pos;
+	float prev_screen_ratio;
+};
+
+#endif // REPROJECTION_HPP
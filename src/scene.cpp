@@ -0,0 +1,46 @@
+#include "scene.hpp"
+
+#include "generators.hpp"
+#include "parallel.hpp"
+#include "voxelizer.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+
+
+VoxelGrid createScene(const Options &options) {
+	auto start = std::chrono::steady_clock::now();
+	VoxelGrid grid;
+	if (!options.model.empty()) {
+		if (!voxelizeObj(options.model.c_str(), options.grid_size, Material::SOLID, options.solid, grid)) {
+			exit(1);
+		}
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		printf("Voxelized %s into %dx%dx%d in %.3f ms\n", options.model.c_str(),
+		       grid.size.x, grid.size.y, grid.size.z, ms);
+		return grid;
+	}
+
+	std::unique_ptr<Generator> generator;
+	if (!options.heightmap.empty()) {
+		generator = loadHeightmap(options.heightmap.c_str(), Material::SOLID);
+		if (!generator) exit(1);
+	} else {
+		generator = createGenerator(options.scene, options.grid_size, options.seed);
+	}
+	grid = generateVoxels(*generator, options.grid_size);
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	printf("Generated %dx%dx%d voxels in %.3f ms on %d thread%s\n",
+	       grid.size.x, grid.size.y, grid.size.z, ms, threadCount(), threadCount() == 1 ? "" : "s");
+	return grid;
+}
+
+LightVolume bakeLightVolume(const VoxelGrid &grid, const MortonGrid *morton) {
+	auto start = std::chrono::steady_clock::now();
+	LightVolume volume(grid, morton);
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	printf("Baked light visibility of %d cells in %.3f ms\n", volume.getBakedCellCount(), ms);
+	return volume;
+}
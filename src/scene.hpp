@@ -0,0 +1,23 @@
+#ifndef SCENE_HPP
+#define SCENE_HPP
+
+#include "light-volume.hpp"
+#include "morton-grid.hpp"
+#include "options.hpp"
+#include "voxel-grid.hpp"
+
+
+/**
+ * Returns the voxel grid chosen by the specified options: the voxelized
+ * model or the terrain of the height map if one is given, or the generated
+ * scene otherwise. Exits if the model or height map cannot be loaded.
+ */
+VoxelGrid createScene(const Options &options);
+
+/**
+ * Returns the light visibility volume baked for the specified grid, marching
+ * the Morton copy of it if one is given, and reports the time it took.
+ */
+LightVolume bakeLightVolume(const VoxelGrid &grid, const MortonGrid *morton = nullptr);
+
+#endif // SCENE_HPP
@@ -0,0 +1,25 @@
+#include "screen-quad.hpp"
+
+#include <cstddef>
+
+
+//----------------------Square Model-------------------------------------------
+
+static GLfloat square_vertices[] = {-1.0,-1.0, 0.0,
+                                    -1.0, 1.0, 0.0,
+                                     1.0, 1.0, 0.0,
+                                     1.0,-1.0, 0.0};
+static GLfloat square_tex_coords[] = {0.0, 0.0,
+                                      0.0, 1.0,
+                                      1.0, 1.0,
+                                      1.0, 0.0};
+static GLuint square_indices[] = {0, 1, 2, 0, 2, 3};
+
+
+//----------------------Implementation-----------------------------------------
+
+Model *createScreenQuad() {
+	return LoadDataToModel(
+		square_vertices, NULL, square_tex_coords, NULL,
+		square_indices, 4, 6);
+}
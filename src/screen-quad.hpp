@@ -0,0 +1,13 @@
+#ifndef SCREEN_QUAD_HPP
+#define SCREEN_QUAD_HPP
+
+#include "loadobj.h"
+
+
+/**
+ * Returns a new model covering the whole screen in normalized device
+ * coordinates, for full-screen passes.
+ */
+Model *createScreenQuad();
+
+#endif // SCREEN_QUAD_HPP
@@ -0,0 +1,58 @@
+#include "shader-utils.hpp"
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+//----------------------Globals------------------------------------------------
+
+// Uniform locations by name, per program, including inactive uniforms
+// looked up so far as -1
+using UniformLocations = std::unordered_map<std::string, GLint>;
+static std::unordered_map<GLuint, UniformLocations> programs;
+
+
+//----------------------Implementation-----------------------------------------
+
+/**
+ * Returns the locations of every active uniform of the specified program
+ * outside of blocks. Arrays are listed both as "name" and "name[0]", as
+ * glGetUniformLocation accepts either.
+ */
+static UniformLocations reflectUniforms(GLuint program) {
+	UniformLocations locations;
+	GLint count = 0, max_length = 0;
+	glGetProgramInterfaceiv(program, GL_UNIFORM, GL_ACTIVE_RESOURCES, &count);
+	glGetProgramInterfaceiv(program, GL_UNIFORM, GL_MAX_NAME_LENGTH, &max_length);
+	std::vector<GLchar> name(std::max(max_length, 1));
+	for (GLint i = 0; i < count; ++i) {
+		const GLenum property = GL_LOCATION;
+		GLint location = -1;
+		glGetProgramResourceiv(program, GL_UNIFORM, i, 1, &property, 1, NULL, &location);
+		if (location < 0) continue; // A member of a block
+		glGetProgramResourceName(program, GL_UNIFORM, i, name.size(), NULL, name.data());
+		std::string uniform(name.data());
+		locations[uniform] = location;
+		if (uniform.size() > 3 && uniform.compare(uniform.size() - 3, 3, "[0]") == 0) {
+			locations[uniform.substr(0, uniform.size() - 3)] = location;
+		}
+	}
+	return locations;
+}
+
+GLint uniformLoc(GLuint program, const GLchar *name) {
+	auto found = programs.find(program);
+	if (found == programs.end()) {
+		found = programs.emplace(program, reflectUniforms(program)).first;
+	}
+	UniformLocations &locations = found->second;
+	auto location = locations.find(name);
+	if (location != locations.end()) {
+		return location->second;
+	}
+	std::cout << "WARNING: Uniform " << name << " not found in program " << program << std::endl;
+	locations[name] = -1;
+	return -1;
+}
@@ -6,14 +6,14 @@
 #include <iostream>
 
 
-inline
-GLint uniformLoc(GLuint program, const GLchar *name) {
-	GLint loc = glGetUniformLocation(program, name);
-	if (loc < 0) {
-		std::cout << "WARNING: Uniform " << name << " not found in program " << program << std::endl;
-	}
-	return loc;
-}
+/**
+ * Returns the location of the specified uniform of a linked program, or -1
+ * with a warning if it is not active. The active uniforms of a program are
+ * queried once, when it is first passed, so that later calls do not reach
+ * the driver and warn at most once per uniform. Programs are assumed to
+ * live as long as the context.
+ */
+GLint uniformLoc(GLuint program, const GLchar *name);
 
 inline
 GLint attribLoc(GLuint program, const GLchar *name) {
@@ -0,0 +1,43 @@
+#include "shader-variants.hpp"
+
+#include "GL_utilities.h"
+
+#include <cstdio>
+
+
+//----------------------Implementation-----------------------------------------
+
+std::string shadingDefines(int max_depth, int light_count) {
+	std::string defines;
+	if (max_depth >= 0) {
+		defines += "#define MAX_REFLECTION_DEPTH " + std::to_string(max_depth) + "\n";
+		defines += "#define MAX_REFRACTION_DEPTH " + std::to_string(max_depth) + "\n";
+	}
+	if (light_count > 0) {
+		defines += "#define LIGHT_COUNT " + std::to_string(light_count) + "\n";
+	}
+	return defines;
+}
+
+int ShaderVariants::add(const std::string &defines, bool wait) {
+	GLuint program = loadShadersDefines(vert_file.c_str(), frag_file.c_str(), defines.c_str(), wait);
+	variants.push_back({program, false, false});
+	return variants.size() - 1;
+}
+
+GLuint ShaderVariants::getProgram(int variant) {
+	Variant &v = variants[variant];
+	if (!v.ready && !v.failed) {
+		int status = programReady(v.program);
+		if (status == 0) return 0;
+		if (status < 0) {
+			fprintf(stderr, "Variant %d of %s failed to link\n", variant, frag_file.c_str());
+			v.failed = true;
+		} else {
+			v.ready = true;
+			if (setup) setup(v.program);
+		}
+	}
+	if (v.failed) return variant != 0 ? getProgram(0) : 0;
+	return v.program;
+}
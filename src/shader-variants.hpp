@@ -0,0 +1,64 @@
+#ifndef SHADER_VARIANTS_HPP
+#define SHADER_VARIANTS_HPP
+
+#include "gl-import.hpp"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// Recursion depth of moving views in a window unless chosen with --preview-depth
+#define DEFAULT_PREVIEW_DEPTH 1
+
+
+/**
+ * Returns the defines specializing shaders/shading.glsl for the specified
+ * max depth of reflection and refraction rays, left at the shader default
+ * if negative, and for the specified number of lights, left to the lights
+ * uploaded if 0.
+ */
+std::string shadingDefines(int max_depth, int light_count);
+
+/**
+ * Variants of a vertex and fragment shader pair, each compiled with its own
+ * defines inserted after the #version line, e.g. a lower recursion depth to
+ * preview moving views with. Variants not waited for are compiled in the
+ * background if the driver can, and used once done.
+ *
+ * Uniforms are per program, so every program is passed to a setup function
+ * when first returned. The camera is shared through the camera block.
+ */
+class ShaderVariants {
+
+public:
+	ShaderVariants() {}
+	ShaderVariants(const char *vert_file, const char *frag_file, std::function<void(GLuint)> setup)
+		: vert_file{vert_file}, frag_file{frag_file}, setup{setup} {}
+
+	/**
+	 * Starts compiling a variant with the specified defines and returns its
+	 * index. Waits for the program if wait is set.
+	 */
+	int add(const std::string &defines, bool wait);
+
+	/**
+	 * Returns the program of the specified variant, or 0 while it is still
+	 * being compiled. Variants that failed to link fall back to the first
+	 * variant added, the full one, or 0 if that failed too.
+	 */
+	GLuint getProgram(int variant);
+
+private:
+	struct Variant {
+		GLuint program;
+		bool ready;  // Set up and returned by getProgram
+		bool failed; // Failed to link, never returned
+	};
+
+	std::string vert_file;
+	std::string frag_file;
+	std::function<void(GLuint)> setup;
+	std::vector<Variant> variants;
+};
+
+#endif // SHADER_VARIANTS_HPP
@@ -0,0 +1,256 @@
+#ifndef SIMD_MATH_HPP
+#define SIMD_MATH_HPP
+
+// SIMD counterparts of glsl-math.hpp for the CPU hot paths, on GCC vector
+// extensions so that they compile to SSE, or AVX where enabled, without
+// intrinsics. Packets hold one vec3 per lane in separate x, y and z vectors,
+// and are converted to and from vec3 and mat4 at the API boundary.
+//
+// Without AVX, comparisons of 8 lanes are split into scalar code, so code
+// that tests masks is better off with 4 lanes there.
+//
+// Operations keep the order of their scalar counterparts, so that lanes get
+// the same results as the scalar code they replace.
+//
+// Every helper is always inlined, as 8-wide vectors are passed and returned
+// in memory without AVX but in registers with it, so that no call between
+// code built for either remains. Returning them by value is still warned
+// about by -Wpsabi, at every call and instantiation, so it is ignored here
+// and by the makefile for the files using 8 lanes.
+
+#include "glsl-math.hpp"
+
+#include "VectorUtils3.h"
+
+#include <cmath>
+#include <limits>
+
+#define SIMD_INLINE inline __attribute__((always_inline))
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+
+typedef float floatx4 __attribute__((vector_size(16)));
+typedef float floatx8 __attribute__((vector_size(32)));
+typedef int   intx4   __attribute__((vector_size(16)));
+typedef int   intx8   __attribute__((vector_size(32)));
+
+// Number of lanes of a vector of floats or ints
+template <typename V>
+constexpr int laneCount() {
+	return sizeof(V) / sizeof(float);
+}
+
+template <typename V>
+SIMD_INLINE
+V splat(float a) {
+	V v;
+	for (int i = 0; i < laneCount<V>(); ++i) v[i] = a;
+	return v;
+}
+
+// 0, 1, 2, ... in successive lanes
+template <typename V>
+SIMD_INLINE
+V laneIndices() {
+	V v;
+	for (int i = 0; i < laneCount<V>(); ++i) v[i] = i;
+	return v;
+}
+
+/**
+ * Returns a where mask is set, i.e. -1 as the result of a comparison, and b
+ * elsewhere.
+ */
+template <typename M, typename V>
+SIMD_INLINE
+V select(const M &mask, const V &a, const V &b) {
+	return mask ? a : b;
+}
+
+template <typename M>
+SIMD_INLINE
+bool any(const M &mask) {
+	for (int i = 0; i < laneCount<M>(); ++i) {
+		if (mask[i]) return true;
+	}
+	return false;
+}
+
+template <typename M>
+SIMD_INLINE
+bool all(const M &mask) {
+	for (int i = 0; i < laneCount<M>(); ++i) {
+		if (!mask[i]) return false;
+	}
+	return true;
+}
+
+SIMD_INLINE floatx4 min(const floatx4 &a, const floatx4 &b) { return b < a ? b : a; }
+SIMD_INLINE floatx8 min(const floatx8 &a, const floatx8 &b) { return b < a ? b : a; }
+SIMD_INLINE floatx4 max(const floatx4 &a, const floatx4 &b) { return a < b ? b : a; }
+SIMD_INLINE floatx8 max(const floatx8 &a, const floatx8 &b) { return a < b ? b : a; }
+
+template <typename F>
+SIMD_INLINE
+F sqrtLanes(const F &v) {
+	F r;
+	for (int i = 0; i < laneCount<F>(); ++i) r[i] = std::sqrt(v[i]);
+	return r;
+}
+
+template <typename F>
+SIMD_INLINE
+F floorLanes(const F &v) {
+	F r;
+	for (int i = 0; i < laneCount<F>(); ++i) r[i] = std::floor(v[i]);
+	return r;
+}
+
+// A vec3 per lane, with one vector per component
+template <typename F>
+struct vec3xN {
+	F x, y, z;
+	SIMD_INLINE vec3xN() {}
+	SIMD_INLINE vec3xN(const F &x, const F &y, const F &z) : x{x}, y{y}, z{z} {}
+	// The same vector in every lane
+	SIMD_INLINE explicit vec3xN(vec3 v) : x{splat<F>(v.x)}, y{splat<F>(v.y)}, z{splat<F>(v.z)} {}
+
+	SIMD_INLINE vec3 lane(int i) const { return vec3(x[i], y[i], z[i]); }
+	SIMD_INLINE void setLane(int i, vec3 v) { x[i] = v.x; y[i] = v.y; z[i] = v.z; }
+};
+
+typedef vec3xN<floatx4> vec3x4;
+typedef vec3xN<floatx8> vec3x8;
+typedef vec3xN<intx4>   ivec3x4;
+typedef vec3xN<intx8>   ivec3x8;
+
+// Each lane converted between floats and ints, as a cast
+template <typename To, typename From>
+SIMD_INLINE
+vec3xN<To> convertLanes(const vec3xN<From> &v) {
+	return vec3xN<To>(__builtin_convertvector(v.x, To), __builtin_convertvector(v.y, To), __builtin_convertvector(v.z, To));
+}
+
+template <typename F>
+SIMD_INLINE
+vec3xN<F> operator+(const vec3xN<F> &a, const vec3xN<F> &b) {
+	return vec3xN<F>(a.x + b.x, a.y + b.y, a.z + b.z);
+}
+
+template <typename F>
+SIMD_INLINE
+vec3xN<F> operator-(const vec3xN<F> &a, const vec3xN<F> &b) {
+	return vec3xN<F>(a.x - b.x, a.y - b.y, a.z - b.z);
+}
+
+template <typename F>
+SIMD_INLINE
+vec3xN<F> operator-(const vec3xN<F> &a) {
+	return vec3xN<F>(-a.x, -a.y, -a.z);
+}
+
+// Scaled by a value per lane
+template <typename F>
+SIMD_INLINE
+vec3xN<F> operator*(const F &s, const vec3xN<F> &a) {
+	return vec3xN<F>(s * a.x, s * a.y, s * a.z);
+}
+
+template <typename F>
+SIMD_INLINE
+vec3xN<F> operator*(const vec3xN<F> &a, const F &s) {
+	return vec3xN<F>(a.x * s, a.y * s, a.z * s);
+}
+
+template <typename F>
+SIMD_INLINE
+vec3xN<F> operator/(const vec3xN<F> &a, const F &s) {
+	return vec3xN<F>(a.x / s, a.y / s, a.z / s);
+}
+
+template <typename F>
+SIMD_INLINE
+vec3xN<F> mul(const vec3xN<F> &a, const vec3xN<F> &b) {
+	return vec3xN<F>(a.x * b.x, a.y * b.y, a.z * b.z);
+}
+
+template <typename F>
+SIMD_INLINE
+vec3xN<F> min(const vec3xN<F> &a, const vec3xN<F> &b) {
+	return vec3xN<F>(min(a.x, b.x), min(a.y, b.y), min(a.z, b.z));
+}
+
+template <typename F>
+SIMD_INLINE
+vec3xN<F> max(const vec3xN<F> &a, const vec3xN<F> &b) {
+	return vec3xN<F>(max(a.x, b.x), max(a.y, b.y), max(a.z, b.z));
+}
+
+template <typename F>
+SIMD_INLINE
+F dot(const vec3xN<F> &a, const vec3xN<F> &b) {
+	return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+template <typename F>
+SIMD_INLINE
+F lengthSqrd(const vec3xN<F> &v) {
+	return dot(v, v);
+}
+
+template <typename F>
+SIMD_INLINE
+vec3xN<F> normalize(const vec3xN<F> &v) {
+	return v / sqrtLanes(lengthSqrd(v));
+}
+
+template <typename F>
+SIMD_INLINE
+vec3xN<F> inverse(const vec3xN<F> &v) {
+	F one = splat<F>(1.0f);
+	return vec3xN<F>(one / v.x, one / v.y, one / v.z);
+}
+
+template <typename F>
+SIMD_INLINE
+vec3xN<F> floor(const vec3xN<F> &v) {
+	return vec3xN<F>(floorLanes(v.x), floorLanes(v.y), floorLanes(v.z));
+}
+
+/**
+ * Returns m * p for the point p of every lane, as mat4 * vec3 in
+ * VectorUtils3 with the row-major m.
+ */
+template <typename F>
+SIMD_INLINE
+vec3xN<F> transformPoint(const mat4 &m, const vec3xN<F> &p) {
+	return vec3xN<F>(
+		splat<F>(m.m[0]) * p.x + splat<F>(m.m[1]) * p.y + splat<F>(m.m[2])  * p.z + splat<F>(m.m[3]),
+		splat<F>(m.m[4]) * p.x + splat<F>(m.m[5]) * p.y + splat<F>(m.m[6])  * p.z + splat<F>(m.m[7]),
+		splat<F>(m.m[8]) * p.x + splat<F>(m.m[9]) * p.y + splat<F>(m.m[10]) * p.z + splat<F>(m.m[11]));
+}
+
+/**
+ * Returns m * d for the direction d of every lane, ignoring translation.
+ */
+template <typename F>
+SIMD_INLINE
+vec3xN<F> transformDirection(const mat4 &m, const vec3xN<F> &d) {
+	return vec3xN<F>(
+		splat<F>(m.m[0]) * d.x + splat<F>(m.m[1]) * d.y + splat<F>(m.m[2])  * d.z,
+		splat<F>(m.m[4]) * d.x + splat<F>(m.m[5]) * d.y + splat<F>(m.m[6])  * d.z,
+		splat<F>(m.m[8]) * d.x + splat<F>(m.m[9]) * d.y + splat<F>(m.m[10]) * d.z);
+}
+
+// Infinity in every lane, e.g. to start a running min
+template <typename F>
+SIMD_INLINE
+F infinityLanes() {
+	return splat<F>(std::numeric_limits<float>::infinity());
+}
+
+#pragma GCC diagnostic pop
+
+#endif // SIMD_MATH_HPP
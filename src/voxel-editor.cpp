@@ -0,0 +1,161 @@
+#include "voxel-editor.hpp"
+
+#include "distance-field.hpp"
+#include "lights.hpp"
+#include "materials.hpp"
+
+#include <cmath>
+
+
+//----------------------Implementation-----------------------------------------
+
+/**
+ * Uploads the box [lo, hi] of the specified values to the 3D texture bound
+ * to the specified texture unit, read in place from the full grid.
+ */
+static void uploadBox(GLenum unit, GLuint texture, GLenum format, const VoxelGrid &values,
+                      ivec3 lo, ivec3 hi)
+{
+	ivec3 box = hi - lo + ivec3(1);
+	glActiveTexture(unit);
+	glBindTexture(GL_TEXTURE_3D, texture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, values.size.x);
+	glPixelStorei(GL_UNPACK_IMAGE_HEIGHT, values.size.y);
+	glPixelStorei(GL_UNPACK_SKIP_PIXELS, lo.x);
+	glPixelStorei(GL_UNPACK_SKIP_ROWS, lo.y);
+	glPixelStorei(GL_UNPACK_SKIP_IMAGES, lo.z);
+	glTexSubImage3D(GL_TEXTURE_3D, 0, lo.x, lo.y, lo.z, box.x, box.y, box.z,
+	                format, GL_UNSIGNED_BYTE, values.voxels.data());
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	glPixelStorei(GL_UNPACK_IMAGE_HEIGHT, 0);
+	glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+	glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+	glPixelStorei(GL_UNPACK_SKIP_IMAGES, 0);
+	glActiveTexture(GL_TEXTURE0);
+}
+
+/**
+ * Updates every brick of the specified brickmap overlapping [lo, hi].
+ */
+static void updateBricks(Brickmap &brickmap, const VoxelGrid &grid, ivec3 lo, ivec3 hi) {
+	for (int z = lo.z >> BRICK_SHIFT; z <= hi.z >> BRICK_SHIFT; ++z) {
+		for (int y = lo.y >> BRICK_SHIFT; y <= hi.y >> BRICK_SHIFT; ++y) {
+			for (int x = lo.x >> BRICK_SHIFT; x <= hi.x >> BRICK_SHIFT; ++x) {
+				brickmap.updateBrick(ivec3(x, y, z), grid);
+			}
+		}
+	}
+}
+
+void VoxelEditor::initGpu(GLuint shader) {
+	this->shader = shader;
+	glUseProgram(shader);
+
+	if (structure == VoxelStructure::OCTREE) {
+		octree = Octree(*grid);
+		octree.upload(shader);
+	} else if (structure == VoxelStructure::BRICKMAP) {
+		gpu_brickmap = Brickmap(*grid);
+		gpu_brickmap.upload();
+	} else {
+		voxel_tex = uploadVoxelTexture(*grid);
+		if (structure == VoxelStructure::DISTANCE_FIELD) {
+			distances = computeDistanceField(*grid);
+			distance_tex = uploadDistanceField(distances);
+		}
+	}
+	setVoxelUniforms(shader, grid->size, structure);
+
+	// Material table and the default lights around the grid, as initVoxels
+	uploadMaterials();
+	uploadLights(placeLights(grid->size));
+}
+
+bool VoxelEditor::clip(ivec3 &lo, ivec3 &hi) const {
+	lo = ivec3(std::max(lo.x, 0), std::max(lo.y, 0), std::max(lo.z, 0));
+	hi = ivec3(std::min(hi.x, grid->size.x - 1), std::min(hi.y, grid->size.y - 1), std::min(hi.z, grid->size.z - 1));
+	return lo.x <= hi.x && lo.y <= hi.y && lo.z <= hi.z;
+}
+
+void VoxelEditor::markDirty(ivec3 lo, ivec3 hi) {
+	if (!hasChanges()) {
+		dirty_lo = lo;
+		dirty_hi = hi;
+		return;
+	}
+	dirty_lo = ivec3(std::min(dirty_lo.x, lo.x), std::min(dirty_lo.y, lo.y), std::min(dirty_lo.z, lo.z));
+	dirty_hi = ivec3(std::max(dirty_hi.x, hi.x), std::max(dirty_hi.y, hi.y), std::max(dirty_hi.z, hi.z));
+}
+
+void VoxelEditor::setVoxel(ivec3 voxel, GLubyte value) {
+	fillBox(voxel, voxel, value);
+}
+
+void VoxelEditor::fillBox(ivec3 lo, ivec3 hi, GLubyte value) {
+	if (!clip(lo, hi)) return;
+	for (int z = lo.z; z <= hi.z; ++z) {
+		for (int y = lo.y; y <= hi.y; ++y) {
+			for (int x = lo.x; x <= hi.x; ++x) {
+				GLubyte &voxel = grid->at(x, y, z);
+				if (voxel == value) continue;
+				voxel = value;
+				markDirty(ivec3(x, y, z), ivec3(x, y, z));
+			}
+		}
+	}
+}
+
+void VoxelEditor::setSphere(vec3 center, float radius, GLubyte value, bool keep_void) {
+	ivec3 lo = ivec3((int)std::floor(center.x - radius), (int)std::floor(center.y - radius), (int)std::floor(center.z - radius));
+	ivec3 hi = ivec3((int)std::floor(center.x + radius), (int)std::floor(center.y + radius), (int)std::floor(center.z + radius));
+	if (!clip(lo, hi)) return;
+	for (int z = lo.z; z <= hi.z; ++z) {
+		for (int y = lo.y; y <= hi.y; ++y) {
+			for (int x = lo.x; x <= hi.x; ++x) {
+				vec3 offset = vec3(x + 0.5, y + 0.5, z + 0.5) - center;
+				GLubyte &voxel = grid->at(x, y, z);
+				if (lengthSqrd(offset) > radius * radius || voxel == value) continue;
+				if (keep_void && voxel == STD_VOID_INDEX) continue;
+				voxel = value;
+				markDirty(ivec3(x, y, z), ivec3(x, y, z));
+			}
+		}
+	}
+}
+
+void VoxelEditor::uploadVoxels(ivec3 lo, ivec3 hi) {
+	if (structure == VoxelStructure::OCTREE) {
+		octree.update(*grid, lo, hi);
+		octree.upload(shader);
+	} else if (structure == VoxelStructure::BRICKMAP) {
+		updateBricks(gpu_brickmap, *grid, lo, hi);
+		gpu_brickmap.upload();
+	} else {
+		uploadBox(GL_TEXTURE0, voxel_tex, GL_RED, *grid, lo, hi);
+		if (structure == VoxelStructure::DISTANCE_FIELD) {
+			ivec3 changed_lo, changed_hi;
+			updateDistanceField(distances, *grid, lo, hi, changed_lo, changed_hi);
+			uploadBox(GL_TEXTURE0 + DISTANCE_FIELD_TEXTURE_UNIT, distance_tex, GL_RED_INTEGER,
+			          distances, changed_lo, changed_hi);
+		}
+	}
+}
+
+bool VoxelEditor::update() {
+	if (!hasChanges()) return false;
+	ivec3 lo = dirty_lo;
+	ivec3 hi = dirty_hi;
+	dirty_lo = ivec3(0);
+	dirty_hi = ivec3(-1);
+
+	if (cpu_brickmap != nullptr) updateBricks(*cpu_brickmap, *grid, lo, hi);
+	// Before the light volume, which may march it
+	if (cpu_morton != nullptr) cpu_morton->update(*grid, lo, hi);
+	if (light_volume != nullptr) light_volume->update(*grid, lo, hi);
+	if (shader != 0) {
+		uploadVoxels(lo, hi);
+		if (light_volume != nullptr) light_volume->upload(shader);
+	}
+	return true;
+}
@@ -0,0 +1,106 @@
+#ifndef VOXEL_EDITOR_HPP
+#define VOXEL_EDITOR_HPP
+
+#include "brickmap.hpp"
+#include "gl-import.hpp"
+#include "glsl-math.hpp"
+#include "light-volume.hpp"
+#include "morton-grid.hpp"
+#include "octree.hpp"
+#include "voxel-generator.hpp"
+#include "voxel-grid.hpp"
+
+
+/**
+ * Changes voxels of a grid after it has been set up for rendering. Edits
+ * only change the grid and grow a dirty box around them, and update brings
+ * every structure derived from the grid up to date within that box: the
+ * brickmap used on the CPU and the light volume, if set, and the voxels
+ * uploaded by initGpu, of which only the changed region is sent.
+ *
+ * Edits are clipped to the grid. Changes made between two calls to update
+ * are covered by a single box, so that far apart edits should be followed
+ * by an update each.
+ */
+class VoxelEditor {
+
+public:
+	VoxelEditor()
+		: grid{nullptr}, structure{VoxelStructure::GRID}, shader{0},
+		  cpu_brickmap{nullptr}, cpu_morton{nullptr}, light_volume{nullptr},
+		  voxel_tex{0}, distance_tex{0}, dirty_lo{0}, dirty_hi{-1} {}
+
+	/**
+	 * Edits the specified grid, which must outlive the editor, stored as
+	 * the specified structure on the GPU.
+	 */
+	VoxelEditor(VoxelGrid &grid, VoxelStructure structure)
+		: VoxelEditor() { this->grid = &grid; this->structure = structure; }
+
+	/**
+	 * Uploads the grid as initVoxels does, keeping the GPU storage so that
+	 * edits update it in place. Without a call, only the grid and the CPU
+	 * structures are updated.
+	 */
+	void initGpu(GLuint shader);
+
+	// Structures kept up to date on the CPU, or null
+	void setBrickmap(Brickmap *brickmap) { cpu_brickmap = brickmap; }
+	void setMortonGrid(MortonGrid *morton) { cpu_morton = morton; }
+	void setLightVolume(LightVolume *volume) { light_volume = volume; }
+
+	const VoxelGrid &getGrid() const { return *grid; }
+	VoxelStructure getStructure() const { return structure; }
+
+	void setVoxel(ivec3 voxel, GLubyte value);
+
+	// Sets every voxel in [lo, hi]
+	void fillBox(ivec3 lo, ivec3 hi, GLubyte value);
+
+	// Sets every voxel whose center lies within radius of center, in voxels
+	void fillSphere(vec3 center, float radius, GLubyte value) { setSphere(center, radius, value, false); }
+
+	/**
+	 * Sets the non-void voxels whose center lies within radius of center, in
+	 * voxels, repainting surfaces without changing their shape.
+	 */
+	void paintSphere(vec3 center, float radius, GLubyte value) { setSphere(center, radius, value, true); }
+
+	bool hasChanges() const { return dirty_lo.x <= dirty_hi.x; }
+
+	/**
+	 * Updates the derived structures and the GPU storage for the voxels
+	 * changed since the last call. Returns whether there were any.
+	 */
+	bool update();
+
+private:
+	/**
+	 * Clips [lo, hi] to the grid, returning false if nothing is left.
+	 */
+	bool clip(ivec3 &lo, ivec3 &hi) const;
+	void setSphere(vec3 center, float radius, GLubyte value, bool keep_void);
+	void markDirty(ivec3 lo, ivec3 hi);
+	void uploadVoxels(ivec3 lo, ivec3 hi);
+
+	VoxelGrid *grid;
+	VoxelStructure structure;
+	GLuint shader; // 0 until initGpu
+
+	Brickmap *cpu_brickmap;
+	MortonGrid *cpu_morton;
+	LightVolume *light_volume;
+
+	// GPU storage of the structure
+	GLuint voxel_tex;
+	GLuint distance_tex;
+	VoxelGrid distances;
+	Octree octree;
+	Brickmap gpu_brickmap;
+
+	// Box of voxels changed since the last update, empty if dirty_lo > dirty_hi
+	ivec3 dirty_lo;
+	ivec3 dirty_hi;
+};
+
+#endif // VOXEL_EDITOR_HPP
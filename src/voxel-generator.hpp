@@ -2,13 +2,29 @@
 #define VOXEL_GENERATOR_HPP
 
 #include "gl-import.hpp"
+#include "voxel-grid.hpp"
 
-// Must be power of 2
-#define VOXEL_COUNT 16
+// Voxel storage on the GPU, must match shaders/raycasting.glsl
+enum class VoxelStructure : GLint {
+	GRID = 0,           // Dense 3D texture
+	OCTREE = 1,         // Sparse voxel octree in a shader storage buffer
+	DISTANCE_FIELD = 2, // Dense 3D texture with a distance texture to skip void
+	BRICKMAP = 3        // Grid of 8^3 bricks, storing only the non-uniform ones
+};
 
-#define VOXEL_WIDTH 1.0
+void printVoxels(const VoxelGrid &grid);
+void initVoxels(GLuint shader, const VoxelGrid &grid, VoxelStructure structure = VoxelStructure::GRID);
 
-void printVoxels(GLubyte grid[VOXEL_COUNT][VOXEL_COUNT][VOXEL_COUNT]);
-void initVoxels(GLuint shader);
+/**
+ * Uploads the specified grid as the dense 3D texture read as voxel_tex, and
+ * returns the texture.
+ */
+GLuint uploadVoxelTexture(const VoxelGrid &grid);
+
+/**
+ * Sets the voxel uniforms of the specified program, for programs other than
+ * the one passed to initVoxels that read the same uploaded voxels.
+ */
+void setVoxelUniforms(GLuint shader, ivec3 grid_size, VoxelStructure structure);
 
 #endif // VOXEL_GENERATOR_HPP
@@ -0,0 +1,44 @@
+#ifndef VOXEL_GRID_HPP
+#define VOXEL_GRID_HPP
+
+#include "gl-import.hpp"
+#include "glsl-math.hpp"
+
+#include <cstddef>
+#include <vector>
+
+// Grid size per axis unless chosen with --grid
+#define DEFAULT_VOXEL_COUNT 16
+
+#define VOXEL_WIDTH 1.0
+
+
+/**
+ * Voxel values on the heap, stored as [z][y][x], with a size chosen at
+ * runtime and not necessarily cubic.
+ */
+struct VoxelGrid {
+	ivec3 size;
+	std::vector<GLubyte> voxels;
+
+	VoxelGrid() : size{0} {}
+	explicit VoxelGrid(ivec3 size)
+		: size{size}, voxels((size_t)size.x * size.y * size.z) {}
+
+	size_t index(int x, int y, int z) const {
+		return ((size_t)z * size.y + y) * size.x + x;
+	}
+
+	bool contains(ivec3 a) const {
+		return a.x >= 0 && a.y >= 0 && a.z >= 0
+		    && a.x < size.x && a.y < size.y && a.z < size.z;
+	}
+
+	GLubyte &at(int x, int y, int z) { return voxels[index(x, y, z)]; }
+	GLubyte at(int x, int y, int z) const { return voxels[index(x, y, z)]; }
+
+	// Largest size of any axis
+	int maxSize() const { return std::max(std::max(size.x, size.y), size.z); }
+};
+
+#endif // VOXEL_GRID_HPP
@@ -0,0 +1,348 @@
+#include "voxelizer.hpp"
+
+#include "parallel.hpp"
+#include "simd-math.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+
+
+//----------------------Constants----------------------------------------------
+
+// Voxel layers along z per parallel task, each task owning the writes to its slab
+#define SLAB_SIZE 4
+
+// Temporary value of void voxels connected to the outside of the grid
+#define OUTSIDE_VALUE 0xFF
+
+// Space left between the model and the sides of the grid, in voxels
+#define FIT_MARGIN 0.5
+
+
+//----------------------Implementation-----------------------------------------
+
+/**
+ * Precomputed separating axis tests of a triangle against voxels, given by
+ * their minimum corner. The axes are the triangle normal and the edge normals
+ * projected onto the xy, yz and zx planes, which together with the voxel
+ * bounds of the triangle cover all 13 axes of the triangle-box test.
+ *
+ * References:
+ *	M. Schwarz, H.-P. Seidel, "Fast Parallel Surface and Solid Voxelization
+ *	on GPUs", 2010
+ */
+struct TriangleSetup {
+	ivec3 lo, hi; // Voxel bounds
+	vec3  n;
+	float d1, d2;
+	float n_xy[3][2], n_yz[3][2], n_zx[3][2];
+	float d_xy[3], d_yz[3], d_zx[3];
+};
+
+static float component(vec3 v, int axis) {
+	return axis == 0 ? v.x : axis == 1 ? v.y : v.z;
+}
+
+/**
+ * Sets up the edge tests of the plane spanned by axes a and b, where
+ * normal_sign orients the edges after the triangle normal.
+ */
+static void setupEdges(const vec3 v[3], int a, int b, float normal_sign, float n_ab[3][2], float d_ab[3]) {
+	for (int i = 0; i < 3; ++i) {
+		vec3 e = v[(i + 1) % 3] - v[i];
+		n_ab[i][0] = -component(e, b) * normal_sign;
+		n_ab[i][1] =  component(e, a) * normal_sign;
+		d_ab[i] = -(n_ab[i][0] * component(v[i], a) + n_ab[i][1] * component(v[i], b))
+		        + std::max(0.0f, n_ab[i][0]) + std::max(0.0f, n_ab[i][1]);
+	}
+}
+
+/**
+ * Returns false for degenerate triangles, which cover no voxels.
+ */
+static bool setupTriangle(const vec3 v[3], ivec3 grid_size, TriangleSetup &t) {
+	t.n = CrossProduct(v[1] - v[0], v[2] - v[0]);
+	if (t.n.x == 0.0 && t.n.y == 0.0 && t.n.z == 0.0) {
+		return false;
+	}
+
+	vec3 lo = min(min(v[0], v[1]), v[2]);
+	vec3 hi = max(max(v[0], v[1]), v[2]);
+	t.lo = ivec3(std::max((int)std::floor(lo.x), 0), std::max((int)std::floor(lo.y), 0), std::max((int)std::floor(lo.z), 0));
+	t.hi = ivec3(std::min((int)std::floor(hi.x), grid_size.x - 1),
+	             std::min((int)std::floor(hi.y), grid_size.y - 1),
+	             std::min((int)std::floor(hi.z), grid_size.z - 1));
+
+	// Plane through the triangle against the voxel corners closest to and
+	// furthest from it
+	vec3 c = vec3(t.n.x > 0.0 ? 1.0 : 0.0, t.n.y > 0.0 ? 1.0 : 0.0, t.n.z > 0.0 ? 1.0 : 0.0);
+	t.d1 = dot(t.n, c - v[0]);
+	t.d2 = dot(t.n, (vec3(1.0) - c) - v[0]);
+
+	setupEdges(v, 0, 1, t.n.z >= 0.0 ? 1.0 : -1.0, t.n_xy, t.d_xy);
+	setupEdges(v, 1, 2, t.n.x >= 0.0 ? 1.0 : -1.0, t.n_yz, t.d_yz);
+	setupEdges(v, 2, 0, t.n.y >= 0.0 ? 1.0 : -1.0, t.n_zx, t.d_zx);
+	return true;
+}
+
+static bool edgesOverlap(const float n_ab[3][2], const float d_ab[3], float a, float b) {
+	return n_ab[0][0] * a + n_ab[0][1] * b + d_ab[0] >= 0.0
+	    && n_ab[1][0] * a + n_ab[1][1] * b + d_ab[1] >= 0.0
+	    && n_ab[2][0] * a + n_ab[2][1] * b + d_ab[2] >= 0.0;
+}
+
+// The same per lane
+static inline intx4 edgesOverlap(const float n_ab[3][2], const float d_ab[3], floatx4 a, floatx4 b) {
+	intx4 overlap = splat<intx4>(-1);
+	for (int i = 0; i < 3; ++i) {
+		overlap &= splat<floatx4>(n_ab[i][0]) * a + splat<floatx4>(n_ab[i][1]) * b + d_ab[i] >= 0.0f;
+	}
+	return overlap;
+}
+
+/**
+ * Sets the voxels overlapped by the triangle within the z range [z_lo, z_hi].
+ * Rows are tested 4 voxels at a time, against the edges only where the plane
+ * of the triangle passes through any of them.
+ */
+static void rasterizeTriangle(const TriangleSetup &t, int z_lo, int z_hi, GLubyte value, VoxelGrid &grid) {
+	const floatx4 lanes = laneIndices<floatx4>();
+	const floatx4 n_x = splat<floatx4>(t.n.x);
+	for (int z = std::max(t.lo.z, z_lo); z <= std::min(t.hi.z, z_hi); ++z) {
+		floatx4 z_x4 = splat<floatx4>(z);
+		for (int y = t.lo.y; y <= t.hi.y; ++y) {
+			if (!edgesOverlap(t.n_yz, t.d_yz, y, z)) continue;
+			floatx4 y_x4 = splat<floatx4>(y);
+			float plane_y = t.n.y * y;
+			float plane_z = t.n.z * z;
+			GLubyte *row = &grid.at(0, y, z);
+			for (int x_begin = t.lo.x; x_begin <= t.hi.x; x_begin += laneCount<floatx4>()) {
+				floatx4 x = splat<floatx4>(x_begin) + lanes;
+				floatx4 plane = n_x * x + plane_y + plane_z;
+				intx4 overlap = (plane + t.d1) * (plane + t.d2) <= 0.0f;
+				if (!any(overlap)) continue;
+				overlap &= edgesOverlap(t.n_xy, t.d_xy, x, y_x4);
+				overlap &= edgesOverlap(t.n_zx, t.d_zx, z_x4, x);
+				int count = std::min(laneCount<floatx4>(), t.hi.x - x_begin + 1);
+				for (int i = 0; i < count; ++i) {
+					if (overlap[i]) row[x_begin + i] = value;
+				}
+			}
+		}
+	}
+}
+
+/**
+ * Returns the model vertices scaled and translated into voxel coordinates,
+ * centered in the grid.
+ */
+static std::vector<vec3> fitToGrid(const Model &model, ivec3 grid_size) {
+	const GLfloat *v = model.vertexArray;
+	vec3 lo = vec3(1e30), hi = vec3(-1e30);
+	for (int i = 0; i < model.numVertices; ++i) {
+		vec3 p = vec3(v[3 * i], v[3 * i + 1], v[3 * i + 2]);
+		lo = min(lo, p);
+		hi = max(hi, p);
+	}
+
+	vec3 extent = hi - lo;
+	vec3 room = toVec3(grid_size) - vec3(2.0 * FIT_MARGIN);
+	float scale = 1e30;
+	if (extent.x > 0.0) scale = std::min(scale, room.x / extent.x);
+	if (extent.y > 0.0) scale = std::min(scale, room.y / extent.y);
+	if (extent.z > 0.0) scale = std::min(scale, room.z / extent.z);
+	if (scale == 1e30f) scale = 1.0;
+	vec3 offset = 0.5 * toVec3(grid_size) - scale * (0.5 * (lo + hi));
+
+	std::vector<vec3> vertices(model.numVertices);
+	parallelFor(model.numVertices, [&](int i) {
+		vertices[i] = scale * vec3(v[3 * i], v[3 * i + 1], v[3 * i + 2]) + offset;
+	});
+	return vertices;
+}
+
+/**
+ * Marks the void voxels of row that are next to outside voxels of the
+ * neighbouring row as outside.
+ * Returns true if any voxel changed.
+ */
+static bool propagateRow(GLubyte *row, const GLubyte *neighbour, int n) {
+	GLubyte changed = 0;
+	for (int x = 0; x < n; ++x) {
+		GLubyte reached = (row[x] == STD_VOID_INDEX) & (neighbour[x] == OUTSIDE_VALUE);
+		row[x] |= -reached & OUTSIDE_VALUE;
+		changed |= reached;
+	}
+	return changed;
+}
+
+/**
+ * Propagates OUTSIDE_VALUE through void voxels along the specified axis, in
+ * both directions. Steps along y and z move whole rows at a time, to keep
+ * the memory access contiguous.
+ * Returns true if any voxel changed.
+ */
+static bool sweepOutside(VoxelGrid &grid, int axis) {
+	ivec3 size = grid.size;
+	std::atomic<bool> changed{false};
+
+	if (axis == 0) {
+		parallelFor(size.z, [&](int z) {
+			bool slice_changed = false;
+			for (int y = 0; y < size.y; ++y) {
+				GLubyte *row = &grid.at(0, y, z);
+				for (int x = 1; x < size.x; ++x) {
+					if (row[x] == STD_VOID_INDEX && row[x - 1] == OUTSIDE_VALUE) {
+						row[x] = OUTSIDE_VALUE;
+						slice_changed = true;
+					}
+				}
+				for (int x = size.x - 2; x >= 0; --x) {
+					if (row[x] == STD_VOID_INDEX && row[x + 1] == OUTSIDE_VALUE) {
+						row[x] = OUTSIDE_VALUE;
+						slice_changed = true;
+					}
+				}
+			}
+			if (slice_changed) changed = true;
+		});
+		return changed;
+	}
+
+	// Rows (y, z) are stepped along y for axis 1, or along z for axis 2
+	int steps = axis == 1 ? size.y : size.z;
+	int lines = axis == 1 ? size.z : size.y;
+	parallelFor(lines, [&](int line) {
+		auto row = [&](int i) {
+			return axis == 1 ? &grid.at(0, i, line) : &grid.at(0, line, i);
+		};
+		bool line_changed = false;
+		for (int i = 1; i < steps; ++i) {
+			line_changed |= propagateRow(row(i), row(i - 1), size.x);
+		}
+		for (int i = steps - 2; i >= 0; --i) {
+			line_changed |= propagateRow(row(i), row(i + 1), size.x);
+		}
+		if (line_changed) changed = true;
+	});
+	return changed;
+}
+
+/**
+ * Sets every void voxel not connected to the sides of the grid to the
+ * specified value.
+ */
+static void fillInterior(VoxelGrid &grid, GLubyte value) {
+	ivec3 size = grid.size;
+	parallelFor(size.z, [&](int z) {
+		for (int y = 0; y < size.y; ++y) {
+			for (int x = 0; x < size.x; ++x) {
+				bool side = x == 0 || y == 0 || z == 0
+				         || x == size.x - 1 || y == size.y - 1 || z == size.z - 1;
+				GLubyte &voxel = grid.at(x, y, z);
+				if (side && voxel == STD_VOID_INDEX) voxel = OUTSIDE_VALUE;
+			}
+		}
+	});
+
+	// Flood the outside with axis sweeps, until concave parts are reached too.
+	// A sweep leaves its own axis settled, so the flood is done once the
+	// other two axes have been swept without changes after it.
+	int settled_axes = 0;
+	for (int axis = 0; settled_axes < 3; axis = (axis + 1) % 3) {
+		settled_axes = sweepOutside(grid, axis) ? 1 : settled_axes + 1;
+	}
+
+	parallelFor(size.z, [&](int z) {
+		for (int y = 0; y < size.y; ++y) {
+			for (int x = 0; x < size.x; ++x) {
+				GLubyte &voxel = grid.at(x, y, z);
+				if (voxel == OUTSIDE_VALUE) {
+					voxel = STD_VOID_INDEX;
+				} else if (voxel == STD_VOID_INDEX) {
+					voxel = value;
+				}
+			}
+		}
+	});
+}
+
+int voxelizeModel(const Model &model, Material material, bool solid, VoxelGrid &grid) {
+	std::vector<vec3> vertices = fitToGrid(model, grid.size);
+	int triangle_count = model.numIndices / 3;
+	int slab_count = (grid.size.z + SLAB_SIZE - 1) / SLAB_SIZE;
+
+	// Bin the triangles by the slabs they overlap, as a prefix sum of counts
+	std::vector<int> slab_starts(slab_count + 1, 0);
+	auto slabRange = [&](int tri, int &first, int &last) {
+		const GLuint *index = &model.indexArray[3 * tri];
+		float lo = std::min(std::min(vertices[index[0]].z, vertices[index[1]].z), vertices[index[2]].z);
+		float hi = std::max(std::max(vertices[index[0]].z, vertices[index[1]].z), vertices[index[2]].z);
+		first = std::max((int)std::floor(lo), 0) / SLAB_SIZE;
+		last = std::min((int)std::floor(hi), grid.size.z - 1) / SLAB_SIZE;
+	};
+	for (int tri = 0; tri < triangle_count; ++tri) {
+		int first, last;
+		slabRange(tri, first, last);
+		for (int slab = first; slab <= last; ++slab) ++slab_starts[slab + 1];
+	}
+	for (int slab = 0; slab < slab_count; ++slab) {
+		slab_starts[slab + 1] += slab_starts[slab];
+	}
+	std::vector<int> bins(slab_starts[slab_count]);
+	std::vector<int> fill = slab_starts;
+	for (int tri = 0; tri < triangle_count; ++tri) {
+		int first, last;
+		slabRange(tri, first, last);
+		for (int slab = first; slab <= last; ++slab) bins[fill[slab]++] = tri;
+	}
+
+	// Slabs are disjoint, so no two tasks write the same voxel
+	GLubyte value = (GLubyte)material;
+	parallelFor(slab_count, [&](int slab) {
+		int z_lo = slab * SLAB_SIZE;
+		int z_hi = std::min(z_lo + SLAB_SIZE, grid.size.z) - 1;
+		for (int i = slab_starts[slab]; i < slab_starts[slab + 1]; ++i) {
+			const GLuint *index = &model.indexArray[3 * bins[i]];
+			vec3 v[3] = {vertices[index[0]], vertices[index[1]], vertices[index[2]]};
+			TriangleSetup t;
+			if (setupTriangle(v, grid.size, t)) {
+				rasterizeTriangle(t, z_lo, z_hi, value, grid);
+			}
+		}
+	});
+
+	if (solid) {
+		fillInterior(grid, value);
+	}
+	return triangle_count;
+}
+
+bool voxelizeObj(const char *path, ivec3 size, Material material, bool solid, VoxelGrid &grid) {
+	// LoadModel does not survive missing files
+	FILE *file = fopen(path, "rb");
+	if (file == NULL) {
+		fprintf(stderr, "Unable to open file '%s'\n", path);
+		return false;
+	}
+	fclose(file);
+
+	Model *model = LoadModel(path);
+	if (model == NULL || model->numVertices == 0) {
+		fprintf(stderr, "No geometry in '%s'\n", path);
+		return false;
+	}
+
+	grid = VoxelGrid(size);
+	voxelizeModel(*model, material, solid, grid);
+
+	// Not DisposeModel, which deletes GL buffers that were never created
+	free(model->vertexArray);
+	free(model->normalArray);
+	free(model->texCoordArray);
+	free(model->colorArray);
+	free(model->indexArray);
+	free(model);
+	return true;
+}
@@ -0,0 +1,27 @@
+#ifndef VOXELIZER_HPP
+#define VOXELIZER_HPP
+
+#include "materials.hpp"
+#include "voxel-grid.hpp"
+
+#include "loadobj.h"
+
+
+/**
+ * Sets every voxel of the grid overlapped by a triangle of the specified
+ * model to the specified material. The model is scaled uniformly and centered
+ * to fit inside the grid. If solid, voxels enclosed by the surface are set as
+ * well, which requires the surface to be closed.
+ *
+ * Returns the number of triangles voxelized.
+ */
+int voxelizeModel(const Model &model, Material material, bool solid, VoxelGrid &grid);
+
+/**
+ * Loads the specified OBJ file and voxelizes it into a new grid of the
+ * specified size, as voxelizeModel.
+ * Returns false, leaving grid untouched, if the file could not be loaded.
+ */
+bool voxelizeObj(const char *path, ivec3 size, Material material, bool solid, VoxelGrid &grid);
+
+#endif // VOXELIZER_HPP
@@ -0,0 +1,265 @@
+#include "wavefront-renderer.hpp"
+
+#include "shader-utils.hpp"
+
+#include "GL_utilities.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+
+
+//----------------------Constants----------------------------------------------
+
+// Stages of shaders/wavefront-dispatch.comp
+#define STAGE_EXTEND 0
+#define STAGE_SHADOW 1
+
+#define FRAME_IMAGE_UNIT 0
+
+#define GENERATE_GROUP_SIZE 8 // Pixels per axis, also used by the resolve kernel
+
+
+//----------------------Implementation-----------------------------------------
+
+// Laid out as WavefrontState in shaders/wavefront.glsl
+struct WavefrontState {
+	GLuint extend_groups[4];
+	GLuint shadow_groups[4];
+	GLuint ray_count;
+	GLuint next_ray_count;
+	GLuint shadow_count;
+	GLuint ray_peak;
+	GLuint shadow_peak;
+};
+
+static GLuint groupCount(int size, int group_size) {
+	return (GLuint)((size + group_size - 1) / group_size);
+}
+
+WavefrontRenderer::WavefrontRenderer()
+	: generate_program{0}, dispatch_program{0}, extend_program{0}, shadow_program{0}, resolve_program{0},
+	  ray_queues{0, 0}, shadow_queue{0}, state_buffer{0}, accumulation_buffer{0},
+	  ray_capacity{0}, shadow_capacity{0}, frame_tex{0}, frame_fbo{0}, frame_width{0}, frame_height{0}, width{0}, height{0},
+	  output_width{0}, output_height{0},
+	  peaks_buffer{0}, peaks_fence{0}
+{}
+
+bool WavefrontRenderer::init() {
+	generate_program = loadComputeShader("shaders/wavefront-generate.comp");
+	dispatch_program = loadComputeShader("shaders/wavefront-dispatch.comp");
+	extend_program = loadComputeShader("shaders/wavefront-extend.comp");
+	shadow_program = loadComputeShader("shaders/wavefront-shadow.comp");
+	resolve_program = loadComputeShader("shaders/wavefront-resolve.comp");
+	GLuint programs[] = {generate_program, dispatch_program, extend_program, shadow_program, resolve_program};
+	for (GLuint program : programs) {
+		GLint linked = GL_FALSE;
+		if (program != 0) glGetProgramiv(program, GL_LINK_STATUS, &linked);
+		if (linked != GL_TRUE) {
+			fprintf(stderr, "Failed to load the wavefront kernels\n");
+			return false;
+		}
+	}
+
+	glGenBuffers(2, ray_queues);
+	glGenBuffers(1, &shadow_queue);
+	glGenBuffers(1, &state_buffer);
+	glGenBuffers(1, &accumulation_buffer);
+	glGenBuffers(1, &peaks_buffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, state_buffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(WavefrontState), NULL, GL_DYNAMIC_COPY);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, peaks_buffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, sizeof(WavefrontState), NULL, GL_STREAM_READ);
+
+	glGenTextures(1, &frame_tex);
+	glGenFramebuffers(1, &frame_fbo);
+	printError("init wavefront renderer");
+	return true;
+}
+
+void WavefrontRenderer::setVoxels(const VoxelGrid &grid, VoxelStructure structure) {
+	initVoxels(extend_program, grid, structure);
+	setVoxelUniforms(shadow_program, grid.size, structure);
+}
+
+void WavefrontRenderer::setVoxels(VoxelEditor &editor) {
+	editor.initGpu(extend_program);
+	setVoxelUniforms(shadow_program, editor.getGrid().size, editor.getStructure());
+}
+
+void WavefrontRenderer::setMinRayWeight(float weight) {
+	glUseProgram(extend_program);
+	glUniform1f(uniformLoc(extend_program, "min_ray_weight"), weight);
+}
+
+void WavefrontRenderer::setLightVolume(LightVolume &volume) {
+	volume.upload(extend_program);
+}
+
+void WavefrontRenderer::allocateQueues(size_t ray_capacity, size_t shadow_capacity) {
+	if (ray_capacity != this->ray_capacity) {
+		for (GLuint queue : ray_queues) {
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, queue);
+			glBufferData(GL_SHADER_STORAGE_BUFFER, ray_capacity * QUEUED_RAY_SIZE, NULL, GL_DYNAMIC_COPY);
+		}
+		this->ray_capacity = ray_capacity;
+	}
+	if (shadow_capacity != this->shadow_capacity) {
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, shadow_queue);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, shadow_capacity * SHADOW_RAY_SIZE, NULL, GL_DYNAMIC_COPY);
+		this->shadow_capacity = shadow_capacity;
+	}
+
+	GLuint programs[] = {dispatch_program, extend_program};
+	for (GLuint program : programs) {
+		glUseProgram(program);
+		glUniform1ui(uniformLoc(program, "ray_capacity"), (GLuint)ray_capacity);
+		glUniform1ui(uniformLoc(program, "shadow_capacity"), (GLuint)shadow_capacity);
+	}
+}
+
+void WavefrontRenderer::resize(int width, int height) {
+	frame_width = width;
+	frame_height = height;
+	size_t pixels = (size_t)width * height;
+
+	// Every pixel starts with a primary ray, and with one shadow ray per
+	// light on hitting something, the queues grow from there as needed
+	allocateQueues(std::max(ray_capacity, pixels), std::max(shadow_capacity, 2 * pixels));
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, accumulation_buffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, 3 * pixels * sizeof(GLuint), NULL, GL_DYNAMIC_COPY);
+
+	glBindTexture(GL_TEXTURE_2D, frame_tex);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	GLint read_fbo = 0;
+	glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &read_fbo);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, frame_fbo);
+	glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, frame_tex, 0);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, read_fbo);
+	printError("resize wavefront renderer");
+
+	setRenderSize(width, height);
+	setOutputSize(width, height);
+}
+
+void WavefrontRenderer::setRenderSize(int width, int height) {
+	// Pixels are packed at the traced width, which fits in the buffers of
+	// any size up to the allocated one
+	this->width = std::min(width, frame_width);
+	this->height = std::min(height, frame_height);
+	glUseProgram(generate_program);
+	glUniform2i(uniformLoc(generate_program, "frame_size"), this->width, this->height);
+	glUseProgram(resolve_program);
+	glUniform2i(uniformLoc(resolve_program, "frame_size"), this->width, this->height);
+}
+
+void WavefrontRenderer::setOutputSize(int width, int height) {
+	output_width = width;
+	output_height = height;
+}
+
+void WavefrontRenderer::setSampleCount(int sample_count) {
+	glUseProgram(resolve_program);
+	glUniform1i(uniformLoc(resolve_program, "sample_count"), sample_count);
+}
+
+void WavefrontRenderer::readPeaks() {
+	if (peaks_fence == 0) return;
+	GLenum status = glClientWaitSync(peaks_fence, 0, 0);
+	if (status == GL_TIMEOUT_EXPIRED) return; // Try again next frame
+	glDeleteSync(peaks_fence);
+	peaks_fence = 0;
+	if (status == GL_WAIT_FAILED) return;
+
+	WavefrontState state;
+	glBindBuffer(GL_COPY_READ_BUFFER, peaks_buffer);
+	glGetBufferSubData(GL_COPY_READ_BUFFER, 0, sizeof(state), &state);
+	size_t grown_rays = ray_capacity;
+	size_t grown_shadows = shadow_capacity;
+	if (state.ray_peak > ray_capacity) grown_rays = (size_t)(WAVEFRONT_QUEUE_GROWTH * state.ray_peak);
+	if (state.shadow_peak > shadow_capacity) grown_shadows = (size_t)(WAVEFRONT_QUEUE_GROWTH * state.shadow_peak);
+	if (grown_rays != ray_capacity || grown_shadows != shadow_capacity) {
+		printf("Growing wavefront queues to %zu rays and %zu shadow rays\n", grown_rays, grown_shadows);
+		allocateQueues(grown_rays, grown_shadows);
+	}
+}
+
+void WavefrontRenderer::render(GpuTimer *gpu_timer) {
+	readPeaks();
+
+	// Previous frame done with the state before it is reset
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	WavefrontState state = {};
+	state.ray_count = (GLuint)width * height;
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, state_buffer);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(state), &state);
+
+	int in = 0;
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, RAY_QUEUE_IN_BINDING, ray_queues[in]);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, RAY_QUEUE_OUT_BINDING, ray_queues[1 - in]);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SHADOW_QUEUE_BINDING, shadow_queue);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, WAVEFRONT_STATE_BINDING, state_buffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, ACCUMULATION_BINDING, accumulation_buffer);
+	glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, state_buffer);
+
+	if (gpu_timer) gpu_timer->beginPass("generate");
+	glUseProgram(generate_program);
+	glDispatchCompute(groupCount(width, GENERATE_GROUP_SIZE), groupCount(height, GENERATE_GROUP_SIZE), 1);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+	if (gpu_timer) gpu_timer->endPass("generate");
+
+	for (int bounce = 0; bounce < WAVEFRONT_BOUNCES; ++bounce) {
+		char extend_pass[16], shadow_pass[16];
+		snprintf(extend_pass, sizeof(extend_pass), "extend %d", bounce);
+		snprintf(shadow_pass, sizeof(shadow_pass), "shadow %d", bounce);
+
+		if (gpu_timer) gpu_timer->beginPass(extend_pass);
+		glUseProgram(dispatch_program);
+		glUniform1i(uniformLoc(dispatch_program, "stage"), STAGE_EXTEND);
+		glDispatchCompute(1, 1, 1);
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+		glUseProgram(extend_program);
+		glDispatchComputeIndirect(offsetof(WavefrontState, extend_groups));
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+		if (gpu_timer) gpu_timer->endPass(extend_pass);
+
+		if (gpu_timer) gpu_timer->beginPass(shadow_pass);
+		glUseProgram(dispatch_program);
+		glUniform1i(uniformLoc(dispatch_program, "stage"), STAGE_SHADOW);
+		glDispatchCompute(1, 1, 1);
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+		glUseProgram(shadow_program);
+		glDispatchComputeIndirect(offsetof(WavefrontState, shadow_groups));
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+		if (gpu_timer) gpu_timer->endPass(shadow_pass);
+
+		in = 1 - in;
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, RAY_QUEUE_IN_BINDING, ray_queues[in]);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, RAY_QUEUE_OUT_BINDING, ray_queues[1 - in]);
+	}
+
+	if (gpu_timer) gpu_timer->beginPass("resolve");
+	glUseProgram(resolve_program);
+	glBindImageTexture(FRAME_IMAGE_UNIT, frame_tex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
+	glDispatchCompute(groupCount(width, GENERATE_GROUP_SIZE), groupCount(height, GENERATE_GROUP_SIZE), 1);
+	glMemoryBarrier(GL_FRAMEBUFFER_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+	GLint read_fbo = 0;
+	glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &read_fbo);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, frame_fbo);
+	bool scaled = output_width != width || output_height != height;
+	glBlitFramebuffer(0, 0, width, height, 0, 0, output_width, output_height,
+	                  GL_COLOR_BUFFER_BIT, scaled ? GL_LINEAR : GL_NEAREST);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, read_fbo);
+	if (gpu_timer) gpu_timer->endPass("resolve");
+
+	// Copied aside so that reading them back waits for this frame only
+	if (peaks_fence == 0) {
+		glBindBuffer(GL_COPY_READ_BUFFER, state_buffer);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, peaks_buffer);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, sizeof(WavefrontState));
+		peaks_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+}
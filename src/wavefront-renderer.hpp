@@ -0,0 +1,132 @@
+#ifndef WAVEFRONT_RENDERER_HPP
+#define WAVEFRONT_RENDERER_HPP
+
+// Compute shader alternative to shaders/raytracing.frag, tracing every bounce
+// of the whole frame as one pass over a queue of rays
+
+#include "gl-import.hpp"
+#include "gpu-timer.hpp"
+#include "light-volume.hpp"
+#include "voxel-editor.hpp"
+#include "voxel-generator.hpp"
+#include "voxel-grid.hpp"
+
+// Must match shaders/wavefront.glsl
+#define WAVEFRONT_GROUP_SIZE    64
+#define RAY_QUEUE_IN_BINDING    5
+#define RAY_QUEUE_OUT_BINDING   6
+#define SHADOW_QUEUE_BINDING    7
+#define WAVEFRONT_STATE_BINDING 8
+#define ACCUMULATION_BINDING    9
+
+#define QUEUED_RAY_SIZE 64 // Bytes per QueuedRay
+#define SHADOW_RAY_SIZE 48 // Bytes per ShadowRay
+
+// Max recursion depth in shaders/shading.glsl + 1 for the primary rays
+#define WAVEFRONT_BOUNCES 5
+
+// Queue capacity kept above the most rays queued so far
+#define WAVEFRONT_QUEUE_GROWTH 1.25
+
+
+/**
+ * Renders in stages of compute kernels: primary rays are generated, then
+ * every bounce marches the queued rays, queueing reflection, refraction and
+ * shadow rays, before the shadow rays are marched. Light is accumulated per
+ * pixel and resolved into a float image, averaging progressive samples,
+ * blitted to the bound draw framebuffer.
+ *
+ * Dispatch sizes follow the queue counts on the GPU through indirect
+ * dispatch. Rays beyond the capacity of a queue are dropped, and the queues
+ * grow to the peak counts read back from earlier frames without stalling.
+ */
+class WavefrontRenderer {
+
+public:
+	WavefrontRenderer();
+
+	/**
+	 * Loads the kernels. Returns false if any failed to compile.
+	 */
+	bool init();
+
+	/**
+	 * Uploads the specified voxels, the materials and the default lights.
+	 */
+	void setVoxels(const VoxelGrid &grid, VoxelStructure structure);
+
+	/**
+	 * Uploads the voxels of the specified editor, which updates them in
+	 * place after edits, the materials and the default lights.
+	 */
+	void setVoxels(VoxelEditor &editor);
+
+	void setMinRayWeight(float weight);
+
+	/**
+	 * Uploads the specified baked volume and looks up shadows in it.
+	 */
+	void setLightVolume(LightVolume &volume);
+
+	/**
+	 * Reallocates the per-pixel buffers and the frame for the specified
+	 * size, which is also the size traced at and the output size unless set
+	 * after.
+	 */
+	void resize(int width, int height);
+
+	/**
+	 * Traces the specified size, at most the size of the last resize, into
+	 * the lower left corner of the frame without reallocating anything.
+	 */
+	void setRenderSize(int width, int height);
+
+	/**
+	 * Sets the size of the region of the draw framebuffer the frame is
+	 * blitted to, bilinearly scaled if it differs from the traced size.
+	 */
+	void setOutputSize(int width, int height);
+
+	int getWidth() const { return width; }
+	int getHeight() const { return height; }
+
+	/**
+	 * Sets the number of earlier samples of the same view to average the
+	 * samples rendered next with.
+	 */
+	void setSampleCount(int sample_count);
+
+	/**
+	 * Renders a frame of the view in the camera block, timing every stage
+	 * with gpu_timer if set.
+	 */
+	void render(GpuTimer *gpu_timer = nullptr);
+
+private:
+	void readPeaks();
+	void allocateQueues(size_t ray_capacity, size_t shadow_capacity);
+
+	GLuint generate_program;
+	GLuint dispatch_program;
+	GLuint extend_program;
+	GLuint shadow_program;
+	GLuint resolve_program;
+
+	GLuint ray_queues[2]; // Swapped between in and out every bounce
+	GLuint shadow_queue;
+	GLuint state_buffer;
+	GLuint accumulation_buffer;
+	size_t ray_capacity;    // Rays per queue
+	size_t shadow_capacity; // Shadow rays
+
+	GLuint frame_tex;
+	GLuint frame_fbo;
+	int frame_width, frame_height; // Allocated size
+	int width, height;             // Traced size
+	int output_width, output_height;
+
+	GLuint peaks_buffer; // Copy of the state of an earlier frame, read back for its peaks
+	GLsync peaks_fence;  // Signaled once peaks_buffer is written
+};
+
+#endif // WAVEFRONT_RENDERER_HPP